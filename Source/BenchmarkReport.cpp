@@ -0,0 +1,279 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkreport.cpp
+// ============
+// collect the per-frame counters of a benchmark run and write them as JSON
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BenchmarkReport.h"
+#include "FrameProfiler.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// version of the report layout, raised when fields change
+	const int REPORT_VERSION = 1;
+}
+
+/***********************************************************
+ *  SetProperty()
+ *
+ *  This method is used for adding a string property that
+ *  describes the run, replacing one of the same name.
+ ***********************************************************/
+void BenchmarkReport::SetProperty(const std::string& name, const std::string& value)
+{
+	std::ostringstream encoded;
+	TraceRecorder::WriteJSONString(encoded, value);
+	for (PROPERTY& property : m_properties)
+	{
+		if (property.name == name)
+		{
+			property.value = encoded.str();
+			return;
+		}
+	}
+
+	PROPERTY property;
+	property.name = name;
+	property.value = encoded.str();
+	m_properties.push_back(property);
+}
+
+/***********************************************************
+ *  SetProperty()
+ *
+ *  This method is used for adding a numeric property that
+ *  describes the run, replacing one of the same name.  The
+ *  value is written with enough digits to read it back
+ *  exactly, so seeds and counts are never rounded.
+ ***********************************************************/
+void BenchmarkReport::SetProperty(const std::string& name, double value)
+{
+	std::ostringstream encoded;
+	encoded << std::setprecision(17) << value;
+	for (PROPERTY& property : m_properties)
+	{
+		if (property.name == name)
+		{
+			property.value = encoded.str();
+			return;
+		}
+	}
+
+	PROPERTY property;
+	property.name = name;
+	property.value = encoded.str();
+	m_properties.push_back(property);
+}
+
+/***********************************************************
+ *  AddFrame()
+ *
+ *  This method is used for adding the timings and counters
+ *  of a rendered frame.
+ ***********************************************************/
+void BenchmarkReport::AddFrame(const FRAME_SAMPLE& sample)
+{
+	m_frames.push_back(sample);
+}
+
+/***********************************************************
+ *  WriteStatistics()
+ *
+ *  This method is used for writing the minimum, mean, p50,
+ *  p95, p99 and maximum of the passed in values as a named
+ *  JSON object.
+ ***********************************************************/
+void BenchmarkReport::WriteStatistics(std::ostream& output, const char* name, std::vector<float> values)
+{
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (float value : values)
+	{
+		sum += value;
+	}
+	float mean = values.empty() ? 0.0f : (float)(sum / values.size());
+
+	output << "  \"" << name << "\": { "
+		<< "\"min\": " << (values.empty() ? 0.0f : values.front())
+		<< ", \"mean\": " << mean
+		<< ", \"p50\": " << FrameProfiler::GetPercentile(values, 50.0f)
+		<< ", \"p95\": " << FrameProfiler::GetPercentile(values, 95.0f)
+		<< ", \"p99\": " << FrameProfiler::GetPercentile(values, 99.0f)
+		<< ", \"max\": " << (values.empty() ? 0.0f : values.back())
+		<< " }";
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing the run properties, the
+ *  statistics of the frame timings and counters, memory use
+ *  and the raw frame times to a JSON file.
+ ***********************************************************/
+bool BenchmarkReport::Write(const std::string& filename) const
+{
+	std::ofstream reportFile(filename.c_str());
+	if (!reportFile.is_open())
+	{
+		std::cout << "Could not write benchmark report:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<float> frameTimes;
+	std::vector<float> cpuTimes;
+	std::vector<float> updateTimes;
+	std::vector<float> drawCalls;
+	std::vector<float> stateChanges;
+	std::vector<float> skippedChanges;
+	std::vector<float> visibleObjects;
+	std::vector<float> culledObjects;
+	size_t peakTextureBytes = 0;
+	for (const FRAME_SAMPLE& frame : m_frames)
+	{
+		frameTimes.push_back(frame.frameMilliseconds);
+		cpuTimes.push_back(frame.cpuMilliseconds);
+		updateTimes.push_back(frame.updateMilliseconds);
+		drawCalls.push_back((float)frame.drawCalls);
+		stateChanges.push_back((float)frame.stateChanges);
+		skippedChanges.push_back((float)frame.stateChangesSkipped);
+		visibleObjects.push_back((float)frame.visibleObjects);
+		culledObjects.push_back((float)frame.culledObjects);
+		peakTextureBytes = std::max(peakTextureBytes, frame.textureResidentBytes);
+	}
+
+	reportFile << "{" << std::endl;
+	reportFile << "  \"version\": " << REPORT_VERSION << "," << std::endl;
+	for (const PROPERTY& property : m_properties)
+	{
+		reportFile << "  ";
+		TraceRecorder::WriteJSONString(reportFile, property.name);
+		reportFile << ": " << property.value << "," << std::endl;
+	}
+	reportFile << "  \"frames\": " << m_frames.size() << "," << std::endl;
+
+	WriteStatistics(reportFile, "frameMilliseconds", frameTimes);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "cpuFrameMilliseconds", cpuTimes);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "updateMilliseconds", updateTimes);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "drawCalls", drawCalls);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "stateChanges", stateChanges);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "stateChangesSkipped", skippedChanges);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "visibleObjects", visibleObjects);
+	reportFile << "," << std::endl;
+	WriteStatistics(reportFile, "culledObjects", culledObjects);
+	reportFile << "," << std::endl;
+
+	reportFile << "  \"memory\": { "
+		<< "\"textureResidentBytes\": " << (m_frames.empty() ? 0 : m_frames.back().textureResidentBytes)
+		<< ", \"textureResidentPeakBytes\": " << peakTextureBytes
+		<< ", \"processPeakBytes\": " << GetPeakMemoryBytes()
+		<< " }," << std::endl;
+
+	reportFile << "  \"frameTimes\": [";
+	for (size_t i = 0; i < frameTimes.size(); i++)
+	{
+		reportFile << ((i > 0) ? ", " : "") << frameTimes[i];
+	}
+	reportFile << "]" << std::endl;
+	reportFile << "}" << std::endl;
+
+	if (!reportFile.good())
+	{
+		std::cout << "Could not write benchmark report:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPeakMemoryBytes()
+ *
+ *  This method is used for getting the peak resident memory
+ *  of the process, as reported by the operating system.
+ ***********************************************************/
+size_t BenchmarkReport::GetPeakMemoryBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return((size_t)counters.PeakWorkingSetSize);
+	}
+	return(0);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return(0);
+	}
+#ifdef __APPLE__
+	// macOS reports bytes
+	return((size_t)usage.ru_maxrss);
+#else
+	// Linux reports kilobytes
+	return((size_t)usage.ru_maxrss * 1024);
+#endif
+#endif
+}
+
+/***********************************************************
+ *  GetProcessCPUSeconds()
+ *
+ *  This method is used for getting the CPU time used so far
+ *  by all the threads of the process, in user and kernel
+ *  mode, as reported by the operating system.
+ ***********************************************************/
+double BenchmarkReport::GetProcessCPUSeconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		return(0.0);
+	}
+	ULARGE_INTEGER kernel;
+	ULARGE_INTEGER user;
+	kernel.LowPart = kernelTime.dwLowDateTime;
+	kernel.HighPart = kernelTime.dwHighDateTime;
+	user.LowPart = userTime.dwLowDateTime;
+	user.HighPart = userTime.dwHighDateTime;
+	// file times count 100 nanosecond intervals
+	return((double)(kernel.QuadPart + user.QuadPart) * 1.0e-7);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return(0.0);
+	}
+	return((double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+		(double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6);
+#endif
+}
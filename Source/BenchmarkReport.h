@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarkreport.h
+// ============
+// collect the per-frame counters of a benchmark run and write them as JSON
+//
+//  A benchmark run renders a fixed number of frames along a camera path at a
+//  fixed timestep.  Every frame adds its timings and counters, and at the
+//  end the report is written as a JSON object: the properties describing
+//  the run, the min/mean/p50/p95/p99/max statistics of each timing and
+//  counter, memory use and the raw frame times, so runs of different
+//  builds can be compared by a script.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  BenchmarkReport
+ *
+ *  This class contains the frames of a benchmark run and
+ *  the methods for summarizing and writing them.
+ ***********************************************************/
+class BenchmarkReport
+{
+public:
+	// timings and counters of a single frame
+	struct FRAME_SAMPLE
+	{
+		// wall clock time of the whole frame, including the swap
+		float frameMilliseconds;
+		// CPU time from the start of the frame to its submission
+		float cpuMilliseconds;
+		float updateMilliseconds;
+		int drawCalls;
+		int stateChanges;
+		int stateChangesSkipped;
+		int visibleObjects;
+		int culledObjects;
+		size_t textureResidentBytes;
+	};
+
+	// describe the run, the values are written as given
+	void SetProperty(const std::string& name, const std::string& value);
+	void SetProperty(const std::string& name, double value);
+
+	void AddFrame(const FRAME_SAMPLE& sample);
+	int GetFrameCount() const { return (int)m_frames.size(); }
+
+	// write the report as a JSON object
+	bool Write(const std::string& filename) const;
+
+	// most memory the process has had resident, 0 when unknown
+	static size_t GetPeakMemoryBytes();
+	// user and system CPU time of every thread of the process,
+	// 0 when unknown
+	static double GetProcessCPUSeconds();
+
+private:
+	struct PROPERTY
+	{
+		std::string name;
+		// value encoded as JSON
+		std::string value;
+	};
+
+	std::vector<PROPERTY> m_properties;
+	std::vector<FRAME_SAMPLE> m_frames;
+
+	static void WriteStatistics(std::ostream& output, const char* name, std::vector<float> values);
+};
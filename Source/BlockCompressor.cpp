@@ -0,0 +1,296 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompressor.cpp
+// ============
+// CPU encoder for the BC1 and BC3 (S3TC) texture block formats
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// declaration of the global variables and defines
+namespace
+{
+	const int BLOCK_TEXELS = 16;
+
+	/***********************************************************
+	 *  PackColor565()
+	 *
+	 *  Rounds an 8 bit per channel color to 565.
+	 ***********************************************************/
+	unsigned short PackColor565(float red, float green, float blue)
+	{
+		int r = (int)(std::min(std::max(red, 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		int g = (int)(std::min(std::max(green, 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+		int b = (int)(std::min(std::max(blue, 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		return((unsigned short)((r << 11) | (g << 5) | b));
+	}
+
+	/***********************************************************
+	 *  UnpackColor565()
+	 *
+	 *  Expands a 565 color back to 8 bits per channel the way
+	 *  the hardware decoder does.
+	 ***********************************************************/
+	void UnpackColor565(unsigned short color, int rgb[3])
+	{
+		int r = (color >> 11) & 31;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+}
+
+/***********************************************************
+ *  GetCompressedSize()
+ *
+ *  This method is used for sizing a compressed image,
+ *  counting partial blocks at the edges as whole blocks.
+ ***********************************************************/
+size_t BlockCompressor::GetCompressedSize(int width, int height, BLOCK_FORMAT format)
+{
+	size_t blocksWide = (size_t)((width + 3) / 4);
+	size_t blocksHigh = (size_t)((height + 3) / 4);
+	size_t blockSize = (format == BLOCK_BC3) ? 16 : 8;
+	return(blocksWide * blocksHigh * blockSize);
+}
+
+/***********************************************************
+ *  CompressImage()
+ *
+ *  This method is used for compressing an image block by
+ *  block, in rows of blocks from the first image row.
+ ***********************************************************/
+void BlockCompressor::CompressImage(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int channels,
+	BLOCK_FORMAT format,
+	unsigned char* output)
+{
+	unsigned char texels[BLOCK_TEXELS * 4];
+
+	for (int blockY = 0; blockY < height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < width; blockX += 4)
+		{
+			// gather the block as RGBA, repeating the edge texels
+			for (int y = 0; y < 4; y++)
+			{
+				int sourceY = std::min(blockY + y, height - 1);
+				for (int x = 0; x < 4; x++)
+				{
+					int sourceX = std::min(blockX + x, width - 1);
+					const unsigned char* pTexel = pixels + ((size_t)sourceY * width + sourceX) * channels;
+					unsigned char* pTarget = texels + (y * 4 + x) * 4;
+					pTarget[0] = pTexel[0];
+					pTarget[1] = pTexel[1];
+					pTarget[2] = pTexel[2];
+					pTarget[3] = (channels == 4) ? pTexel[3] : 255;
+				}
+			}
+
+			if (format == BLOCK_BC3)
+			{
+				CompressAlphaBlock(texels, output);
+				output += 8;
+			}
+			CompressColorBlock(texels, output);
+			output += 8;
+		}
+	}
+}
+
+/***********************************************************
+ *  CompressColorBlock()
+ *
+ *  This method is used for encoding the colors of a block.
+ *  The endpoints are the extremes of the texels projected
+ *  on the principal axis of their colors, found with a few
+ *  power iterations on the covariance matrix, and pulled in
+ *  slightly to reduce the error of the interpolated colors.
+ ***********************************************************/
+void BlockCompressor::CompressColorBlock(const unsigned char texels[64], unsigned char output[8])
+{
+	// mean color of the block
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] += texels[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		mean[c] /= (float)BLOCK_TEXELS;
+	}
+
+	// covariance of the colors, xx xy xz yy yz zz
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		float r = texels[i * 4 + 0] - mean[0];
+		float g = texels[i * 4 + 1] - mean[1];
+		float b = texels[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// principal axis by power iteration, starting from luminance
+	float axis[3] = { 0.299f, 0.587f, 0.114f };
+	for (int iteration = 0; iteration < 4; iteration++)
+	{
+		float next[3];
+		next[0] = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		next[1] = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		next[2] = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			axis[c] = next[c] / length;
+		}
+	}
+
+	// extremes of the texels along the axis
+	float minProjection = 1e30f;
+	float maxProjection = -1e30f;
+	for (int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		float projection =
+			(texels[i * 4 + 0] - mean[0]) * axis[0] +
+			(texels[i * 4 + 1] - mean[1]) * axis[1] +
+			(texels[i * 4 + 2] - mean[2]) * axis[2];
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+	float inset = (maxProjection - minProjection) / 16.0f;
+	minProjection += inset;
+	maxProjection -= inset;
+
+	unsigned short color0 = PackColor565(
+		mean[0] + axis[0] * maxProjection,
+		mean[1] + axis[1] * maxProjection,
+		mean[2] + axis[2] * maxProjection);
+	unsigned short color1 = PackColor565(
+		mean[0] + axis[0] * minProjection,
+		mean[1] + axis[1] * minProjection,
+		mean[2] + axis[2] * minProjection);
+
+	// color0 above color1 selects the four color mode
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	unsigned int indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int bestIndex = 0;
+			int bestDistance = 0x7fffffff;
+			for (int p = 0; p < 4; p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int delta = texels[i * 4 + c] - palette[p][c];
+					distance += delta * delta;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= (unsigned int)bestIndex << (i * 2);
+		}
+	}
+
+	output[0] = (unsigned char)(color0 & 0xff);
+	output[1] = (unsigned char)(color0 >> 8);
+	output[2] = (unsigned char)(color1 & 0xff);
+	output[3] = (unsigned char)(color1 >> 8);
+	output[4] = (unsigned char)(indices & 0xff);
+	output[5] = (unsigned char)((indices >> 8) & 0xff);
+	output[6] = (unsigned char)((indices >> 16) & 0xff);
+	output[7] = (unsigned char)(indices >> 24);
+}
+
+/***********************************************************
+ *  CompressAlphaBlock()
+ *
+ *  This method is used for encoding the alpha of a block
+ *  with the block's alpha range as endpoints, in the eight
+ *  value mode.
+ ***********************************************************/
+void BlockCompressor::CompressAlphaBlock(const unsigned char texels[64], unsigned char output[8])
+{
+	int alpha0 = 0;
+	int alpha1 = 255;
+	for (int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		alpha0 = std::max(alpha0, (int)texels[i * 4 + 3]);
+		alpha1 = std::min(alpha1, (int)texels[i * 4 + 3]);
+	}
+
+	unsigned long long indices = 0;
+	if (alpha0 != alpha1)
+	{
+		// palette order of the eight value mode
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for (int p = 1; p < 7; p++)
+		{
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+		}
+
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int alpha = texels[i * 4 + 3];
+			int bestIndex = 0;
+			int bestDistance = 256;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = std::abs(alpha - palette[p]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= (unsigned long long)bestIndex << (i * 3);
+		}
+	}
+
+	output[0] = (unsigned char)alpha0;
+	output[1] = (unsigned char)alpha1;
+	for (int i = 0; i < 6; i++)
+	{
+		output[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xff);
+	}
+}
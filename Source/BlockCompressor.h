@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompressor.h
+// ============
+// CPU encoder for the BC1 and BC3 (S3TC) texture block formats
+//
+//  Images are split into 4x4 texel blocks.  BC1 stores each block in 8
+//  bytes as two 565 endpoint colors and a 2 bit palette index per texel.
+//  BC3 adds an 8 byte alpha block with two 8 bit endpoints and 3 bit
+//  indices.  The color endpoints are fitted along the principal axis of
+//  the block colors.  Partial blocks at the image edges repeat the last
+//  row and column.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  BlockCompressor
+ *
+ *  This class contains the methods for compressing images
+ *  into BC1 or BC3 blocks.
+ ***********************************************************/
+class BlockCompressor
+{
+public:
+	// block formats the compressor can write
+	enum BLOCK_FORMAT
+	{
+		// opaque RGB, 8 bytes per block
+		BLOCK_BC1 = 0,
+		// RGB with interpolated alpha, 16 bytes per block
+		BLOCK_BC3
+	};
+
+	// number of bytes of a compressed image
+	static size_t GetCompressedSize(int width, int height, BLOCK_FORMAT format);
+	// compress an RGB or RGBA image, the output must hold
+	// GetCompressedSize bytes
+	static void CompressImage(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int channels,
+		BLOCK_FORMAT format,
+		unsigned char* output);
+
+private:
+	// compress 16 RGBA texels into the 8 byte color block
+	static void CompressColorBlock(const unsigned char texels[64], unsigned char output[8]);
+	// compress the alpha of 16 RGBA texels into the 8 byte alpha block
+	static void CompressAlphaBlock(const unsigned char texels[64], unsigned char output[8]);
+};
@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ============
+// keyframed camera track that benchmark runs play back
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// shortest view direction that is still normalized when
+	// interpolating between opposite directions
+	const float MIN_FRONT_LENGTH = 0.0001f;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the keyframes of a
+ *  camera path file.  Lines that cannot be parsed, and
+ *  keyframes that are not later than the one before, are
+ *  reported and skipped.
+ ***********************************************************/
+bool CameraPath::Load(const char* filename)
+{
+	std::ifstream pathFile(filename);
+	if (!pathFile.is_open())
+	{
+		std::cout << "Could not load camera path file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_keyframes.clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(pathFile, line))
+	{
+		lineNumber++;
+
+		std::istringstream fields(line);
+		std::string first;
+		if (!(fields >> first) || (first[0] == '#'))
+		{
+			continue;
+		}
+
+		KEYFRAME keyframe;
+		std::istringstream values(line);
+		if (!(values >> keyframe.time
+			>> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+			>> keyframe.front.x >> keyframe.front.y >> keyframe.front.z
+			>> keyframe.zoom))
+		{
+			std::cout << "Skipping camera path line " << lineNumber << ": could not parse keyframe" << std::endl;
+			continue;
+		}
+		if ((!m_keyframes.empty()) && (keyframe.time <= m_keyframes.back().time))
+		{
+			std::cout << "Skipping camera path line " << lineNumber << ": time is not increasing" << std::endl;
+			continue;
+		}
+
+		m_keyframes.push_back(keyframe);
+	}
+
+	return(!m_keyframes.empty());
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the keyframes to a
+ *  camera path file that Load reads back.
+ ***********************************************************/
+bool CameraPath::Save(const char* filename) const
+{
+	std::ofstream pathFile(filename);
+	if (!pathFile.is_open())
+	{
+		std::cout << "Could not write camera path file:" << filename << std::endl;
+		return(false);
+	}
+
+	pathFile << "# <time> <position xyz> <front xyz> <zoom>" << std::endl;
+	pathFile << std::setprecision(9);
+	for (const KEYFRAME& keyframe : m_keyframes)
+	{
+		pathFile << keyframe.time << " "
+			<< keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+			<< keyframe.front.x << " " << keyframe.front.y << " " << keyframe.front.z << " "
+			<< keyframe.zoom << std::endl;
+	}
+
+	return(pathFile.good());
+}
+
+/***********************************************************
+ *  AddKeyframe()
+ *
+ *  This method is used for appending a keyframe to the end
+ *  of the path.
+ ***********************************************************/
+void CameraPath::AddKeyframe(const KEYFRAME& keyframe)
+{
+	if ((!m_keyframes.empty()) && (keyframe.time <= m_keyframes.back().time))
+	{
+		return;
+	}
+
+	m_keyframes.push_back(keyframe);
+}
+
+/***********************************************************
+ *  Evaluate()
+ *
+ *  This method is used for getting the camera state at the
+ *  passed in time.  The position and zoom are interpolated
+ *  linearly between the keyframes around the time, and the
+ *  view direction is interpolated and normalized again.
+ ***********************************************************/
+CameraPath::KEYFRAME CameraPath::Evaluate(float time) const
+{
+	if (m_keyframes.empty())
+	{
+		KEYFRAME keyframe;
+		keyframe.time = time;
+		keyframe.position = glm::vec3(0.0f, 0.0f, 0.0f);
+		keyframe.front = glm::vec3(0.0f, 0.0f, -1.0f);
+		keyframe.zoom = 45.0f;
+		return(keyframe);
+	}
+	if (time <= m_keyframes.front().time)
+	{
+		return(m_keyframes.front());
+	}
+	if (time >= m_keyframes.back().time)
+	{
+		return(m_keyframes.back());
+	}
+
+	// first keyframe later than the time, never the first one
+	auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+		[](float value, const KEYFRAME& keyframe) { return value < keyframe.time; });
+	const KEYFRAME& end = *next;
+	const KEYFRAME& start = *(next - 1);
+	float blend = (time - start.time) / (end.time - start.time);
+
+	KEYFRAME keyframe;
+	keyframe.time = time;
+	keyframe.position = glm::mix(start.position, end.position, blend);
+	keyframe.zoom = start.zoom + (end.zoom - start.zoom) * blend;
+	keyframe.front = glm::mix(start.front, end.front, blend);
+	float frontLength = glm::length(keyframe.front);
+	keyframe.front = (frontLength > MIN_FRONT_LENGTH) ? keyframe.front / frontLength : start.front;
+
+	return(keyframe);
+}
+
+/***********************************************************
+ *  GetDuration()
+ *
+ *  This method is used for getting the time of the last
+ *  keyframe, which is where the path ends.
+ ***********************************************************/
+float CameraPath::GetDuration() const
+{
+	if (m_keyframes.empty())
+	{
+		return(0.0f);
+	}
+
+	return(m_keyframes.back().time);
+}
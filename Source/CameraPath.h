@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// keyframed camera track that benchmark runs play back
+//
+//  A camera path is a list of keyframes, each holding the camera position,
+//  view direction and zoom at a point in time.  The path is sampled by
+//  interpolating between the two keyframes around the requested time, so
+//  a run that samples it at a fixed timestep sees the same views every
+//  time.  Paths are stored as text files, one keyframe per line:
+//
+//    <time> <position xyz> <front xyz> <zoom>
+//
+//  Blank lines and lines starting with # are skipped.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class contains the keyframes of a camera track and
+ *  the methods for loading, saving and sampling it.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// camera state at a point in time, in seconds
+	struct KEYFRAME
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 front;
+		float zoom;
+	};
+
+	// read the keyframes of a camera path file, replacing any
+	// loaded ones
+	bool Load(const char* filename);
+	// write the keyframes to a camera path file
+	bool Save(const char* filename) const;
+
+	// append a keyframe, it is skipped unless it is later than
+	// the last one
+	void AddKeyframe(const KEYFRAME& keyframe);
+	void Clear() { m_keyframes.clear(); }
+
+	// camera state at the passed in time, held at the first and
+	// last keyframes outside the path
+	KEYFRAME Evaluate(float time) const;
+
+	// time of the last keyframe
+	float GetDuration() const;
+	int GetKeyframeCount() const { return (int)m_keyframes.size(); }
+	bool IsEmpty() const { return m_keyframes.empty(); }
+
+private:
+	// keyframes in increasing time order
+	std::vector<KEYFRAME> m_keyframes;
+};
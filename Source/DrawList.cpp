@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawlist.cpp
+// ============
+// queue of draw commands ordered by a packed render state sort key
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DrawList.h"
+
+#include <algorithm>
+
+// declaration of the sort key layout
+namespace
+{
+	// field widths in bits, most significant field first
+	const int SHADER_BITS = 4;
+	const int TEXTURE_BITS = 12;
+	const int MATERIAL_BITS = 12;
+	const int MESH_BITS = 8;
+	const int DEPTH_BITS = 24;
+
+	// offsets of the render state fields within the state part
+	// of the key
+	const int MESH_SHIFT = 0;
+	const int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+	const int TEXTURE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+	const int SHADER_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS;
+	const int STATE_BITS = SHADER_SHIFT + SHADER_BITS;
+
+	// the translucent flag is the most significant field, above
+	// the render state and depth of either key layout
+	const int TRANSLUCENT_SHIFT = STATE_BITS + DEPTH_BITS;
+
+	// view depth that maps to the largest depth key
+	const float MAX_SORT_DEPTH = 100.0f;
+
+	// clamp a value into a key field of the passed in width
+	uint64_t PackField(int value, int bits)
+	{
+		uint64_t maxValue = (1ull << bits) - 1;
+		if (value < 0)
+		{
+			return(0);
+		}
+		if ((uint64_t)value > maxValue)
+		{
+			return(maxValue);
+		}
+		return((uint64_t)value);
+	}
+}
+
+/***********************************************************
+ *  DrawList()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DrawList::DrawList()
+{
+}
+
+/***********************************************************
+ *  ~DrawList()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DrawList::~DrawList()
+{
+	m_commands.clear();
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for packing the render state of a
+ *  draw into a 64 bit sort key.  Untextured draws use key
+ *  texture 0 and textured draws use their slot plus one,
+ *  and the view depth is quantized so closer opaque draws
+ *  sort first within the same state.  Translucent draws
+ *  set the most significant bit so they follow every
+ *  opaque draw, and place their inverted depth above the
+ *  render state so they are drawn back to front whatever
+ *  state they use.
+ ***********************************************************/
+uint64_t DrawList::MakeSortKey(
+	bool bTranslucent,
+	int shaderIndex,
+	int textureSlot,
+	int materialIndex,
+	int meshType,
+	float viewDepth)
+{
+	float depthRatio = viewDepth / MAX_SORT_DEPTH;
+	depthRatio = std::min(std::max(depthRatio, 0.0f), 1.0f);
+	int depthValue = (int)(depthRatio * (float)((1 << DEPTH_BITS) - 1));
+
+	uint64_t stateKey = 0;
+	stateKey |= PackField(shaderIndex, SHADER_BITS) << SHADER_SHIFT;
+	stateKey |= PackField(textureSlot + 1, TEXTURE_BITS) << TEXTURE_SHIFT;
+	stateKey |= PackField(materialIndex, MATERIAL_BITS) << MATERIAL_SHIFT;
+	stateKey |= PackField(meshType, MESH_BITS) << MESH_SHIFT;
+
+	uint64_t sortKey = 0;
+	if (bTranslucent)
+	{
+		int invertedDepth = ((1 << DEPTH_BITS) - 1) - depthValue;
+		sortKey |= 1ull << TRANSLUCENT_SHIFT;
+		sortKey |= PackField(invertedDepth, DEPTH_BITS) << STATE_BITS;
+		sortKey |= stateKey;
+	}
+	else
+	{
+		sortKey |= stateKey << DEPTH_BITS;
+		sortKey |= PackField(depthValue, DEPTH_BITS);
+	}
+
+	return(sortKey);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for ordering the recorded commands
+ *  by sort key, keeping the recorded order for equal keys.
+ ***********************************************************/
+void DrawList::Sort()
+{
+	std::stable_sort(
+		m_commands.begin(),
+		m_commands.end(),
+		[](const DRAW_COMMAND& a, const DRAW_COMMAND& b)
+		{
+			return(a.sortKey < b.sortKey);
+		});
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawlist.h
+// ============
+// queue of draw commands ordered by a packed render state sort key
+//
+//  The sort key packs, from the most significant bits down, a translucent
+//  flag and then the shader, texture slot, material, mesh and quantized view
+//  depth of a draw, so that sorting the queue groups opaque draws that share
+//  state and orders draws that share all state front to back.  Translucent
+//  draws follow every opaque draw, and pack their inverted depth above the
+//  render state so they are blended back to front.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  DrawList
+ *
+ *  This class contains the draw commands recorded for one
+ *  frame and the helpers to build and sort their keys.
+ ***********************************************************/
+class DrawList
+{
+public:
+	// constructor
+	DrawList();
+	// destructor
+	~DrawList();
+
+	struct DRAW_COMMAND
+	{
+		uint64_t sortKey;
+		// index of the scene object to draw
+		int objectIndex;
+	};
+
+	// pack the render state of a draw into a sort key, a
+	// texture slot of -1 means the draw uses a solid color
+	static uint64_t MakeSortKey(
+		bool bTranslucent,
+		int shaderIndex,
+		int textureSlot,
+		int materialIndex,
+		int meshType,
+		float viewDepth);
+
+	// size the list for a number of commands that are then
+	// written by index, possibly from several threads
+	void Resize(int commandCount) { m_commands.resize(commandCount); }
+	void SetCommand(int index, uint64_t sortKey, int objectIndex)
+	{
+		m_commands[index].sortKey = sortKey;
+		m_commands[index].objectIndex = objectIndex;
+	}
+	// order the recorded commands by sort key
+	void Sort();
+
+	const std::vector<DRAW_COMMAND>& GetCommands() const { return m_commands; }
+
+private:
+	// recorded commands for the current frame
+	std::vector<DRAW_COMMAND> m_commands;
+};
@@ -0,0 +1,543 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// render frames into an offscreen framebuffer and write them to image files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "TraceRecorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// digits of the frame number added to the output path
+	const int FRAME_NUMBER_DIGITS = 5;
+	// bytes per pixel of the frames read back and written
+	const int FRAME_CHANNELS = 3;
+	// bytes per pixel of the asynchronous readback, RGBA is the
+	// layout drivers copy into pixel buffers without conversion
+	const int READBACK_CHANNELS = 4;
+	// frames queued for the writer before capturing waits
+	const size_t MAX_QUEUED_FRAMES = 8;
+	// how long a single fence wait may block, in nanoseconds
+	const GLuint64 FENCE_WAIT_NANOSECONDS = 100000000;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+	m_outputPath = "frame.ppm";
+	for (READBACK_SLOT& slot : m_slots)
+	{
+		slot.pixelBuffer = 0;
+		slot.fence = NULL;
+		slot.frameNumber = 0;
+		slot.captureIndex = -1;
+	}
+	m_captureCount = 0;
+	m_stallMilliseconds = 0.0f;
+	m_bStopWriter = false;
+	m_queuedCount = 0;
+	m_completedCount = 0;
+	m_writtenCount = 0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the framebuffer with
+ *  a color and a depth renderbuffer of the passed in size,
+ *  the ring of pixel buffers frames are read back into,
+ *  and the writer thread.  Returns false when the driver
+ *  cannot render into the framebuffer.
+ ***********************************************************/
+bool FrameCapture::Create(int width, int height)
+{
+	Destroy();
+
+	m_width = width;
+	m_height = height;
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Offscreen framebuffer is not complete, status:" << status << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	size_t readbackBytes = (size_t)width * height * READBACK_CHANNELS;
+	for (READBACK_SLOT& slot : m_slots)
+	{
+		glGenBuffers(1, &slot.pixelBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, readbackBytes, NULL, GL_STREAM_READ);
+		slot.fence = NULL;
+		slot.captureIndex = -1;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_captureCount = 0;
+	m_stallMilliseconds = 0.0f;
+	m_bStopWriter = false;
+	m_queuedCount = 0;
+	m_completedCount = 0;
+	m_writtenCount = 0;
+	m_writerThread = std::thread(&FrameCapture::WriterLoop, this);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for writing the frames still in
+ *  flight, stopping the writer thread, and deleting the
+ *  framebuffer, its renderbuffers and the pixel buffers.
+ ***********************************************************/
+void FrameCapture::Destroy()
+{
+	if (m_writerThread.joinable())
+	{
+		Finish();
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_bStopWriter = true;
+		}
+		m_queueCondition.notify_all();
+		m_writerThread.join();
+	}
+
+	for (READBACK_SLOT& slot : m_slots)
+	{
+		if (NULL != slot.fence)
+		{
+			glDeleteSync(slot.fence);
+			slot.fence = NULL;
+		}
+		if (0 != slot.pixelBuffer)
+		{
+			glDeleteBuffers(1, &slot.pixelBuffer);
+			slot.pixelBuffer = 0;
+		}
+		slot.captureIndex = -1;
+	}
+
+	if (0 != m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (0 != m_colorBuffer)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (0 != m_depthBuffer)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for making the framebuffer the
+ *  target of the following draws, covering all of it.  The
+ *  frames read back two or more frames ago are collected
+ *  first, so their copies are done and mapping them does
+ *  not wait on the frame about to render.
+ ***********************************************************/
+void FrameCapture::Bind()
+{
+	CollectFrames(m_captureCount - READBACK_LATENCY);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  ReadFrame()
+ *
+ *  This method is used for reading the color buffer of the
+ *  finished frame into the passed in vector.  The rows are
+ *  in OpenGL order, bottom row first.  The read waits for
+ *  the frame to finish rendering.
+ ***********************************************************/
+void FrameCapture::ReadFrame(std::vector<unsigned char>& pixels)
+{
+	pixels.resize((size_t)m_width * m_height * FRAME_CHANNELS);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	// RGB rows are tightly packed, whatever the width
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used for starting the copy of the
+ *  finished frame into the next pixel buffer of the ring.
+ *  The copy runs on the GPU after the frame, and a fence
+ *  marks when it is done, so this does not wait.
+ ***********************************************************/
+void FrameCapture::CaptureFrame(int frameNumber)
+{
+	READBACK_SLOT& slot = m_slots[m_captureCount % READBACK_SLOT_COUNT];
+	// only happens when frames are captured without Bind
+	if (slot.captureIndex >= 0)
+	{
+		CollectSlot(slot);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+	// with a pack buffer bound, the pixels go to its start
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frameNumber = frameNumber;
+	slot.captureIndex = m_captureCount++;
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for collecting every frame still in
+ *  the ring and waiting until the writer thread is done
+ *  with all of them.
+ ***********************************************************/
+void FrameCapture::Finish()
+{
+	CollectFrames(m_captureCount - 1);
+
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+	m_queueCondition.wait(lock, [this]() { return m_completedCount == m_queuedCount; });
+}
+
+/***********************************************************
+ *  GetWrittenCount()
+ *
+ *  This method is used for getting the number of frames
+ *  the writer thread has written so far.
+ ***********************************************************/
+int FrameCapture::GetWrittenCount()
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	return(m_writtenCount);
+}
+
+/***********************************************************
+ *  CollectFrames()
+ *
+ *  This method is used for collecting the pending frames
+ *  captured at or before the passed in capture index,
+ *  oldest first.
+ ***********************************************************/
+void FrameCapture::CollectFrames(int lastCaptureIndex)
+{
+	while (true)
+	{
+		READBACK_SLOT* pOldest = NULL;
+		for (READBACK_SLOT& slot : m_slots)
+		{
+			if ((slot.captureIndex >= 0) &&
+				(slot.captureIndex <= lastCaptureIndex) &&
+				((NULL == pOldest) || (slot.captureIndex < pOldest->captureIndex)))
+			{
+				pOldest = &slot;
+			}
+		}
+		if (NULL == pOldest)
+		{
+			return;
+		}
+
+		CollectSlot(*pOldest);
+	}
+}
+
+/***********************************************************
+ *  CollectSlot()
+ *
+ *  This method is used for mapping the pixel buffer of a
+ *  captured frame once its copy is done, and queueing a
+ *  copy of its pixels for the writer thread.  Capturing
+ *  waits here when the writer has fallen too far behind.
+ ***********************************************************/
+void FrameCapture::CollectSlot(READBACK_SLOT& slot)
+{
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	// the copy normally finished frames ago, so this rarely waits
+	GLenum waitResult = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NANOSECONDS);
+	while (waitResult == GL_TIMEOUT_EXPIRED)
+	{
+		waitResult = glClientWaitSync(slot.fence, 0, FENCE_WAIT_NANOSECONDS);
+	}
+	auto waitEnd = std::chrono::high_resolution_clock::now();
+	m_stallMilliseconds += std::chrono::duration<float, std::milli>(waitEnd - waitStart).count();
+
+	glDeleteSync(slot.fence);
+	slot.fence = NULL;
+	slot.captureIndex = -1;
+	if (waitResult == GL_WAIT_FAILED)
+	{
+		std::cout << "Could not read back frame:" << slot.frameNumber << std::endl;
+		return;
+	}
+
+	FRAME_JOB job;
+	job.frameNumber = slot.frameNumber;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (!m_freePixels.empty())
+		{
+			job.pixels.swap(m_freePixels.back());
+			m_freePixels.pop_back();
+		}
+	}
+
+	size_t readbackBytes = (size_t)m_width * m_height * READBACK_CHANNELS;
+	job.pixels.resize(readbackBytes);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readbackBytes, GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		std::memcpy(job.pixels.data(), pMapped, readbackBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (NULL == pMapped)
+	{
+		std::cout << "Could not map frame:" << slot.frameNumber << std::endl;
+		return;
+	}
+
+	waitStart = std::chrono::high_resolution_clock::now();
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		m_queueCondition.wait(lock, [this]() { return m_writeQueue.size() < MAX_QUEUED_FRAMES; });
+		m_writeQueue.push_back(std::move(job));
+		m_queuedCount++;
+	}
+	m_queueCondition.notify_all();
+	waitEnd = std::chrono::high_resolution_clock::now();
+	m_stallMilliseconds += std::chrono::duration<float, std::milli>(waitEnd - waitStart).count();
+}
+
+/***********************************************************
+ *  WriterLoop()
+ *
+ *  This method is used for converting the queued frames to
+ *  RGB and writing them to their files on the writer
+ *  thread, until told to stop once the queue is empty.
+ ***********************************************************/
+void FrameCapture::WriterLoop()
+{
+	TraceRecorder::SetThreadName("FrameWriter");
+	std::vector<unsigned char> framePixels;
+	while (true)
+	{
+		FRAME_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this]() { return (m_bStopWriter) || (!m_writeQueue.empty()); });
+			if (m_writeQueue.empty())
+			{
+				return;
+			}
+			job = std::move(m_writeQueue.front());
+			m_writeQueue.pop_front();
+		}
+		// there is room in the queue again
+		m_queueCondition.notify_all();
+
+		TraceRecorder::ScopedEvent event("WriteFrame");
+		size_t pixelCount = (size_t)m_width * m_height;
+		framePixels.resize(pixelCount * FRAME_CHANNELS);
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			framePixels[i * FRAME_CHANNELS] = job.pixels[i * READBACK_CHANNELS];
+			framePixels[i * FRAME_CHANNELS + 1] = job.pixels[i * READBACK_CHANNELS + 1];
+			framePixels[i * FRAME_CHANNELS + 2] = job.pixels[i * READBACK_CHANNELS + 2];
+		}
+
+		std::string filename = GetFramePath(job.frameNumber);
+		bool bWritten = WriteFrame(filename, m_width, m_height, framePixels);
+		if (!bWritten)
+		{
+			std::cout << "Could not write frame:" << filename << std::endl;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			if (bWritten)
+			{
+				m_writtenCount++;
+			}
+			m_completedCount++;
+			m_freePixels.push_back(std::move(job.pixels));
+		}
+		m_queueCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  GetFramePath()
+ *
+ *  This method is used for getting the file name of a
+ *  frame, the output path with the zero padded frame number
+ *  added before its extension.
+ ***********************************************************/
+std::string FrameCapture::GetFramePath(int frameNumber) const
+{
+	char frameDigits[32];
+	std::snprintf(frameDigits, sizeof(frameDigits), "_%0*d", FRAME_NUMBER_DIGITS, frameNumber);
+
+	size_t extension = m_outputPath.find_last_of('.');
+	size_t separator = m_outputPath.find_last_of("/\\");
+	if ((extension == std::string::npos) ||
+		((separator != std::string::npos) && (extension < separator)))
+	{
+		return(m_outputPath + frameDigits + ".ppm");
+	}
+
+	return(m_outputPath.substr(0, extension) + frameDigits + m_outputPath.substr(extension));
+}
+
+/***********************************************************
+ *  WriteFrame()
+ *
+ *  This method is used for writing a frame as a TGA file
+ *  when the file name ends in .tga, and as a PPM file
+ *  otherwise.
+ ***********************************************************/
+bool FrameCapture::WriteFrame(const std::string& filename, int width, int height, const std::vector<unsigned char>& pixels)
+{
+	if (pixels.size() < (size_t)width * height * FRAME_CHANNELS)
+	{
+		return(false);
+	}
+
+	size_t length = filename.size();
+	if ((length >= 4) &&
+		((filename.compare(length - 4, 4, ".tga") == 0) || (filename.compare(length - 4, 4, ".TGA") == 0)))
+	{
+		return(WriteTGA(filename, width, height, pixels));
+	}
+
+	return(WritePPM(filename, width, height, pixels));
+}
+
+/***********************************************************
+ *  WritePPM()
+ *
+ *  This method is used for writing a binary PPM file.  PPM
+ *  rows run top to bottom, so the rows are written in
+ *  reverse.
+ ***********************************************************/
+bool FrameCapture::WritePPM(const std::string& filename, int width, int height, const std::vector<unsigned char>& pixels)
+{
+	std::ofstream frameFile(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!frameFile)
+	{
+		return(false);
+	}
+
+	frameFile << "P6\n" << width << " " << height << "\n255\n";
+	size_t rowBytes = (size_t)width * FRAME_CHANNELS;
+	for (int row = height - 1; row >= 0; row--)
+	{
+		frameFile.write((const char*)&pixels[row * rowBytes], rowBytes);
+	}
+
+	return(frameFile.good());
+}
+
+/***********************************************************
+ *  WriteTGA()
+ *
+ *  This method is used for writing an uncompressed 24 bit
+ *  TGA file.  TGA rows run bottom to top by default, like
+ *  OpenGL, but the channels are stored as BGR.
+ ***********************************************************/
+bool FrameCapture::WriteTGA(const std::string& filename, int width, int height, const std::vector<unsigned char>& pixels)
+{
+	std::ofstream frameFile(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!frameFile)
+	{
+		return(false);
+	}
+
+	unsigned char header[18] = { 0 };
+	// uncompressed true color image
+	header[2] = 2;
+	header[12] = (unsigned char)(width & 0xFF);
+	header[13] = (unsigned char)((width >> 8) & 0xFF);
+	header[14] = (unsigned char)(height & 0xFF);
+	header[15] = (unsigned char)((height >> 8) & 0xFF);
+	header[16] = 24;
+	frameFile.write((const char*)header, sizeof(header));
+
+	size_t rowBytes = (size_t)width * FRAME_CHANNELS;
+	std::vector<unsigned char> row(rowBytes);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* source = &pixels[y * rowBytes];
+		for (int x = 0; x < width; x++)
+		{
+			row[x * 3] = source[x * 3 + 2];
+			row[x * 3 + 1] = source[x * 3 + 1];
+			row[x * 3 + 2] = source[x * 3];
+		}
+		frameFile.write((const char*)row.data(), rowBytes);
+	}
+
+	return(frameFile.good());
+}
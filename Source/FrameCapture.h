@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// render frames into an offscreen framebuffer and write them to image files
+//
+//  In headless mode the scene is drawn into a framebuffer object with its
+//  own color and depth renderbuffers instead of the window, so frames come
+//  out the same whether or not a display is attached.  After each frame
+//  the color buffer is read back and written as a binary PPM or an
+//  uncompressed TGA file, chosen by the extension of the output path.
+//
+//  Readback is asynchronous.  Each frame is copied into the next pixel
+//  buffer of a small ring, with a fence after the copy, and is only mapped
+//  two frames later when the copy has long finished, so the CPU never
+//  waits for the GPU to drain.  The mapped pixels are handed to a writer
+//  thread that encodes and writes the files while later frames render.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class contains the offscreen framebuffer frames
+ *  are rendered into and the methods for reading them back
+ *  and saving them.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	// create the framebuffer with the passed in size and start
+	// the writer thread
+	bool Create(int width, int height);
+	// write the pending frames, then delete the framebuffer, its
+	// renderbuffers and the pixel buffers
+	void Destroy();
+	// render into the framebuffer instead of the window, and
+	// hand the frames read back two frames ago to the writer
+	void Bind();
+
+	// read the color buffer of the finished frame right away,
+	// bottom row first, RGB
+	void ReadFrame(std::vector<unsigned char>& pixels);
+	// start reading back the finished frame, which is written to
+	// the output file of the passed in frame number later
+	void CaptureFrame(int frameNumber);
+	// wait until every captured frame has been written
+	void Finish();
+
+	// set the output path, the frame number is added before the
+	// extension, which selects .ppm or .tga
+	void SetOutputPath(const std::string& outputPath) { m_outputPath = outputPath; }
+	// get the file name of the passed in frame number
+	std::string GetFramePath(int frameNumber) const;
+
+	// write RGB pixels, bottom row first, to a PPM or TGA file
+	static bool WriteFrame(const std::string& filename, int width, int height, const std::vector<unsigned char>& pixels);
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	// frames written since the framebuffer was created
+	int GetWrittenCount();
+	// time the render thread spent waiting for readbacks and
+	// for room in the write queue
+	float GetStallMilliseconds() const { return m_stallMilliseconds; }
+
+private:
+	// frames between a readback and mapping its pixel buffer,
+	// and pixel buffers in the ring
+	static const int READBACK_LATENCY = 2;
+	static const int READBACK_SLOT_COUNT = READBACK_LATENCY + 1;
+
+	// pixel buffer a frame is read back into
+	struct READBACK_SLOT
+	{
+		GLuint pixelBuffer;
+		// signaled when the copy into the buffer is done
+		GLsync fence;
+		int frameNumber;
+		// sequence number of the captured frame, -1 when free
+		int captureIndex;
+	};
+
+	// frame waiting for the writer thread, RGBA as read back
+	struct FRAME_JOB
+	{
+		int frameNumber;
+		std::vector<unsigned char> pixels;
+	};
+
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+	std::string m_outputPath;
+
+	READBACK_SLOT m_slots[READBACK_SLOT_COUNT];
+	// frames captured since the framebuffer was created
+	int m_captureCount;
+	float m_stallMilliseconds;
+
+	// writer thread and the frames queued for it
+	std::thread m_writerThread;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	std::deque<FRAME_JOB> m_writeQueue;
+	// pixel vectors of written frames, reused for new frames
+	std::vector<std::vector<unsigned char>> m_freePixels;
+	bool m_bStopWriter;
+	// frames queued, and frames the writer is done with, written
+	// or not
+	int m_queuedCount;
+	int m_completedCount;
+	int m_writtenCount;
+
+	// map the pixel buffers of every frame captured at or
+	// before the passed in index and queue them for writing
+	void CollectFrames(int lastCaptureIndex);
+	void CollectSlot(READBACK_SLOT& slot);
+	// write queued frames until told to stop
+	void WriterLoop();
+
+	static bool WritePPM(const std::string& filename, int width, int height, const std::vector<unsigned char>& pixels);
+	static bool WriteTGA(const std::string& filename, int width, int height, const std::vector<unsigned char>& pixels);
+};
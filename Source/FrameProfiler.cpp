@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// time the passes of each frame on the CPU and the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+// declaration of global variables
+namespace
+{
+	// frames kept per timer for the percentiles
+	const int SAMPLE_WINDOW_SIZE = 600;
+	// percentiles written by the report
+	const float REPORT_PERCENTILES[] = { 50.0f, 95.0f, 99.0f };
+	// width of the timer name column of the report
+	const int REPORT_NAME_WIDTH = 18;
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	m_frame = 0;
+	// timestamp queries are core since OpenGL 3.3
+	m_bGPUTiming = GLEW_ARB_timer_query;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	for (TIMER& timer : m_timers)
+	{
+		if (timer.bGPUTiming)
+		{
+			glDeleteQueries(GPU_QUERY_FRAMES * 2, &timer.queries[0][0]);
+		}
+	}
+	m_timers.clear();
+}
+
+/***********************************************************
+ *  AddTimer()
+ *
+ *  This method is used for adding a timer with the passed
+ *  in name.  GPU timing is only used when the driver
+ *  supports timestamp queries.
+ ***********************************************************/
+int FrameProfiler::AddTimer(const std::string& name, bool bGPUTiming)
+{
+	TIMER timer;
+	timer.name = name;
+	timer.bGPUTiming = (bGPUTiming) && (m_bGPUTiming);
+	timer.frameMilliseconds = 0.0;
+	timer.bUsedThisFrame = false;
+	timer.cpuWindow.next = 0;
+	timer.gpuWindow.next = 0;
+	for (int i = 0; i < GPU_QUERY_FRAMES; i++)
+	{
+		timer.queries[i][0] = 0;
+		timer.queries[i][1] = 0;
+		timer.bQueryBegun[i] = false;
+		timer.bQueryEnded[i] = false;
+	}
+	if (timer.bGPUTiming)
+	{
+		glGenQueries(GPU_QUERY_FRAMES * 2, &timer.queries[0][0]);
+	}
+
+	m_timers.push_back(timer);
+	return((int)m_timers.size() - 1);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for starting an entry of the passed
+ *  in timer.  The first entry of the frame also writes the
+ *  begin timestamp of its GPU timing.
+ ***********************************************************/
+void FrameProfiler::Begin(int timer)
+{
+	if ((timer < 0) || (timer >= (int)m_timers.size()))
+	{
+		return;
+	}
+
+	TIMER& profileTimer = m_timers[timer];
+	int querySet = m_frame % GPU_QUERY_FRAMES;
+	if ((profileTimer.bGPUTiming) && (!profileTimer.bQueryBegun[querySet]))
+	{
+		glQueryCounter(profileTimer.queries[querySet][0], GL_TIMESTAMP);
+		profileTimer.bQueryBegun[querySet] = true;
+	}
+	profileTimer.start = std::chrono::high_resolution_clock::now();
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for adding the time since Begin to
+ *  the frame time of the passed in timer.  Every exit moves
+ *  the end timestamp of its GPU timing, so the GPU time
+ *  spans from the first entry to the last exit.
+ ***********************************************************/
+void FrameProfiler::End(int timer)
+{
+	if ((timer < 0) || (timer >= (int)m_timers.size()))
+	{
+		return;
+	}
+
+	TIMER& profileTimer = m_timers[timer];
+	auto end = std::chrono::high_resolution_clock::now();
+	profileTimer.frameMilliseconds += std::chrono::duration<double, std::milli>(end - profileTimer.start).count();
+	profileTimer.bUsedThisFrame = true;
+
+	int querySet = m_frame % GPU_QUERY_FRAMES;
+	if (profileTimer.bGPUTiming)
+	{
+		glQueryCounter(profileTimer.queries[querySet][1], GL_TIMESTAMP);
+		profileTimer.bQueryEnded[querySet] = true;
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a new frame.  The
+ *  queries of the frame that last used the query set of
+ *  the new frame are read first.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	m_frame++;
+	int querySet = m_frame % GPU_QUERY_FRAMES;
+	for (TIMER& timer : m_timers)
+	{
+		if (timer.bGPUTiming)
+		{
+			CollectQueries(timer, querySet);
+		}
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for adding the CPU time of every
+ *  timer used this frame to its rolling window.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	for (TIMER& timer : m_timers)
+	{
+		if (timer.bUsedThisFrame)
+		{
+			AddSample(timer.cpuWindow, (float)timer.frameMilliseconds);
+		}
+		timer.frameMilliseconds = 0.0;
+		timer.bUsedThisFrame = false;
+	}
+}
+
+/***********************************************************
+ *  CollectQueries()
+ *
+ *  This method is used for adding the GPU time of the
+ *  passed in query set to the rolling window of a timer.
+ *  The queries were written several frames ago, so they
+ *  are normally done; a frame the GPU has not reached yet
+ *  is dropped instead of waited for.
+ ***********************************************************/
+void FrameProfiler::CollectQueries(TIMER& timer, int querySet)
+{
+	if ((timer.bQueryBegun[querySet]) && (timer.bQueryEnded[querySet]))
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(timer.queries[querySet][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 beginTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(timer.queries[querySet][0], GL_QUERY_RESULT, &beginTime);
+			glGetQueryObjectui64v(timer.queries[querySet][1], GL_QUERY_RESULT, &endTime);
+			if (endTime >= beginTime)
+			{
+				AddSample(timer.gpuWindow, (float)((endTime - beginTime) / 1000000.0));
+			}
+		}
+	}
+
+	timer.bQueryBegun[querySet] = false;
+	timer.bQueryEnded[querySet] = false;
+}
+
+/***********************************************************
+ *  AddSample()
+ *
+ *  This method is used for adding a frame time to a rolling
+ *  window, replacing its oldest time once it is full.
+ ***********************************************************/
+void FrameProfiler::AddSample(SAMPLE_WINDOW& window, float milliseconds)
+{
+	if ((int)window.samples.size() < SAMPLE_WINDOW_SIZE)
+	{
+		window.samples.push_back(milliseconds);
+		return;
+	}
+
+	window.samples[window.next] = milliseconds;
+	window.next = (window.next + 1) % SAMPLE_WINDOW_SIZE;
+}
+
+/***********************************************************
+ *  GetPercentile()
+ *
+ *  This method is used for getting the nearest rank
+ *  percentile of sorted frame times or counters.
+ ***********************************************************/
+float FrameProfiler::GetPercentile(const std::vector<float>& sorted, float percentile)
+{
+	if (sorted.empty())
+	{
+		return(0.0f);
+	}
+
+	int rank = (int)std::ceil(percentile / 100.0f * sorted.size());
+	rank = std::min(std::max(rank, 1), (int)sorted.size());
+	return(sorted[rank - 1]);
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for writing the p50, p95 and p99
+ *  CPU and GPU times of every timer that was used, in
+ *  milliseconds per frame.
+ ***********************************************************/
+void FrameProfiler::Report(std::ostream& output) const
+{
+	output << "INFO: Frame profile in ms, over up to the last " << SAMPLE_WINDOW_SIZE
+		<< " frames of each pass" << std::endl;
+	output << "  " << std::left << std::setw(REPORT_NAME_WIDTH) << "pass" << std::right
+		<< std::setw(8) << "CPU p50" << std::setw(8) << "p95" << std::setw(8) << "p99" << "  |"
+		<< std::setw(8) << "GPU p50" << std::setw(8) << "p95" << std::setw(8) << "p99" << std::endl;
+
+	std::ios::fmtflags flags = output.flags();
+	std::streamsize precision = output.precision();
+	output << std::fixed << std::setprecision(3);
+	for (const TIMER& timer : m_timers)
+	{
+		if (timer.cpuWindow.samples.empty())
+		{
+			continue;
+		}
+
+		output << "  " << std::left << std::setw(REPORT_NAME_WIDTH) << timer.name << std::right;
+
+		std::vector<float> sorted = timer.cpuWindow.samples;
+		std::sort(sorted.begin(), sorted.end());
+		for (float percentile : REPORT_PERCENTILES)
+		{
+			output << std::setw(8) << GetPercentile(sorted, percentile);
+		}
+
+		output << "  |";
+		if (timer.gpuWindow.samples.empty())
+		{
+			output << std::setw(8) << "-" << std::setw(8) << "-" << std::setw(8) << "-";
+		}
+		else
+		{
+			sorted = timer.gpuWindow.samples;
+			std::sort(sorted.begin(), sorted.end());
+			for (float percentile : REPORT_PERCENTILES)
+			{
+				output << std::setw(8) << GetPercentile(sorted, percentile);
+			}
+		}
+		output << std::endl;
+	}
+	output.flags(flags);
+	output.precision(precision);
+}
+
+/***********************************************************
+ *  ScopedTimer()
+ *
+ *  The constructor for the class, starts the timer
+ ***********************************************************/
+FrameProfiler::ScopedTimer::ScopedTimer(FrameProfiler* pProfiler, int timer)
+{
+	m_pProfiler = pProfiler;
+	m_timer = timer;
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->Begin(m_timer);
+	}
+}
+
+/***********************************************************
+ *  ~ScopedTimer()
+ *
+ *  The destructor for the class, stops the timer
+ ***********************************************************/
+FrameProfiler::ScopedTimer::~ScopedTimer()
+{
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->End(m_timer);
+	}
+}
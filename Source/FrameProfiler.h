@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// time the passes of each frame on the CPU and the GPU
+//
+//  Each pass is a named timer, timed with a scoped timer around its code.
+//  The CPU time of every entry of a timer is summed over the frame.  Timers
+//  with GPU timing also write a timestamp query at their first entry and
+//  their last exit of the frame; the queries are read a few frames later,
+//  once the GPU has passed them, so timing never waits on the GPU.  The
+//  last frames of every timer are kept to report their percentiles.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class contains the pass timers and the rolling
+ *  windows of their frame times.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// times the passed in timer until it goes out of scope, does
+	// nothing when the profiler is NULL
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(FrameProfiler* pProfiler, int timer);
+		~ScopedTimer();
+
+	private:
+		FrameProfiler* m_pProfiler;
+		int m_timer;
+	};
+
+	// add a timer, with GPU timing when asked for and supported,
+	// and get its index
+	int AddTimer(const std::string& name, bool bGPUTiming);
+	// start and stop a timer, entries may repeat within a frame
+	// but must not nest
+	void Begin(int timer);
+	void End(int timer);
+
+	// read back finished GPU timings and start a new frame
+	void BeginFrame();
+	// add the times of this frame to the rolling windows
+	void EndFrame();
+
+	// true when the driver supports timestamp queries
+	bool IsGPUTimingSupported() const { return m_bGPUTiming; }
+	// write the percentiles of every timer
+	void Report(std::ostream& output) const;
+
+	// get the nearest rank percentile of sorted values
+	static float GetPercentile(const std::vector<float>& sorted, float percentile);
+
+private:
+	// frames between writing a timestamp query and reading it
+	static const int GPU_QUERY_FRAMES = 4;
+
+	// last frame times of a timer, oldest overwritten first
+	struct SAMPLE_WINDOW
+	{
+		std::vector<float> samples;
+		int next;
+	};
+
+	struct TIMER
+	{
+		std::string name;
+		bool bGPUTiming;
+		// CPU time of this frame and the start of the open entry
+		std::chrono::high_resolution_clock::time_point start;
+		double frameMilliseconds;
+		bool bUsedThisFrame;
+		SAMPLE_WINDOW cpuWindow;
+		SAMPLE_WINDOW gpuWindow;
+		// begin and end timestamp queries of the recent frames
+		GLuint queries[GPU_QUERY_FRAMES][2];
+		bool bQueryBegun[GPU_QUERY_FRAMES];
+		bool bQueryEnded[GPU_QUERY_FRAMES];
+	};
+
+	std::vector<TIMER> m_timers;
+	// frames started, selects the query set of the frame
+	unsigned int m_frame;
+	bool m_bGPUTiming;
+
+	void CollectQueries(TIMER& timer, int querySet);
+	static void AddSample(SAMPLE_WINDOW& window, float milliseconds);
+};
@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.cpp
+// ============
+// record the input of a run to a binary log and read it back for replay
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecorder.h"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+// declaration of global variables
+namespace
+{
+	// first bytes of every input log, and the version of the
+	// record layout
+	const unsigned char LOG_MAGIC[4] = { 'I', 'N', 'P', 'T' };
+	const unsigned int LOG_VERSION = 1;
+	// frames between flushes of the log being recorded, so a
+	// crashed run still leaves most of its input behind
+	const int FLUSH_INTERVAL_FRAMES = 60;
+	// bytes of each record after its type byte
+	const size_t FRAME_PAYLOAD_BYTES = 12;
+	const size_t POINTER_PAYLOAD_BYTES = 16;
+
+	/***********************************************************
+	 *  FloatBits()
+	 *
+	 *  This function is used for getting the bit pattern of a
+	 *  float, and BitsFloat for the reverse.
+	 ***********************************************************/
+	unsigned int FloatBits(float value)
+	{
+		unsigned int bits = 0;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return(bits);
+	}
+	float BitsFloat(unsigned int bits)
+	{
+		float value = 0.0f;
+		std::memcpy(&value, &bits, sizeof(value));
+		return(value);
+	}
+
+	/***********************************************************
+	 *  DoubleBits()
+	 *
+	 *  This function is used for getting the bit pattern of a
+	 *  double, and BitsDouble for the reverse.
+	 ***********************************************************/
+	unsigned long long DoubleBits(double value)
+	{
+		unsigned long long bits = 0;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return(bits);
+	}
+	double BitsDouble(unsigned long long bits)
+	{
+		double value = 0.0;
+		std::memcpy(&value, &bits, sizeof(value));
+		return(value);
+	}
+}
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+	m_readOffset = 0;
+	m_bReplaying = false;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for creating the log file and
+ *  writing its header.
+ ***********************************************************/
+bool InputRecorder::StartRecording(const char* filename)
+{
+	Stop();
+
+	m_logFile.open(filename, std::ios::binary | std::ios::trunc);
+	if (!m_logFile.is_open())
+	{
+		std::cout << "Could not create input log:" << filename << std::endl;
+		return(false);
+	}
+
+	m_logFile.write((const char*)LOG_MAGIC, sizeof(LOG_MAGIC));
+	WriteBytes(LOG_VERSION, 4);
+
+	return(true);
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method is used for reading a whole log file into
+ *  memory and checking its header, so replay never waits
+ *  on the disk.
+ ***********************************************************/
+bool InputRecorder::StartReplay(const char* filename)
+{
+	Stop();
+
+	std::ifstream logFile(filename, std::ios::binary);
+	if (!logFile.is_open())
+	{
+		std::cout << "Could not load input log:" << filename << std::endl;
+		return(false);
+	}
+	m_logBytes.assign(std::istreambuf_iterator<char>(logFile), std::istreambuf_iterator<char>());
+
+	unsigned long long version = 0;
+	m_readOffset = sizeof(LOG_MAGIC);
+	if ((m_logBytes.size() < sizeof(LOG_MAGIC)) ||
+		(std::memcmp(m_logBytes.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) ||
+		(!ReadBytes(version, 4)) ||
+		(version != LOG_VERSION))
+	{
+		std::cout << "Not a supported input log:" << filename << std::endl;
+		m_logBytes.clear();
+		m_readOffset = 0;
+		return(false);
+	}
+
+	m_bReplaying = true;
+	m_frameCount = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for closing the log being recorded,
+ *  or dropping the events of the log being replayed.
+ ***********************************************************/
+void InputRecorder::Stop()
+{
+	if (m_logFile.is_open())
+	{
+		m_logFile.close();
+	}
+	m_logBytes.clear();
+	m_readOffset = 0;
+	m_bReplaying = false;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  RecordFrame()
+ *
+ *  This method is used for recording the start of a frame
+ *  with its time, frame time and key state.
+ ***********************************************************/
+void InputRecorder::RecordFrame(float timestamp, float deltaTime, unsigned int keyState)
+{
+	if (!m_logFile.is_open())
+	{
+		return;
+	}
+
+	m_logFile.put((char)EVENT_FRAME);
+	WriteBytes(FloatBits(timestamp), 4);
+	WriteBytes(FloatBits(deltaTime), 4);
+	WriteBytes(keyState, 4);
+
+	m_frameCount++;
+	if ((m_frameCount % FLUSH_INTERVAL_FRAMES) == 0)
+	{
+		m_logFile.flush();
+	}
+}
+
+/***********************************************************
+ *  RecordCursor()
+ *
+ *  This method is used for recording a cursor move.
+ ***********************************************************/
+void InputRecorder::RecordCursor(double x, double y)
+{
+	if (!m_logFile.is_open())
+	{
+		return;
+	}
+
+	m_logFile.put((char)EVENT_CURSOR);
+	WriteBytes(DoubleBits(x), 8);
+	WriteBytes(DoubleBits(y), 8);
+}
+
+/***********************************************************
+ *  RecordScroll()
+ *
+ *  This method is used for recording a scroll.
+ ***********************************************************/
+void InputRecorder::RecordScroll(double xOffset, double yOffset)
+{
+	if (!m_logFile.is_open())
+	{
+		return;
+	}
+
+	m_logFile.put((char)EVENT_SCROLL);
+	WriteBytes(DoubleBits(xOffset), 8);
+	WriteBytes(DoubleBits(yOffset), 8);
+}
+
+/***********************************************************
+ *  ReadEvent()
+ *
+ *  This method is used for reading the next event of the
+ *  replayed log.  Returns false at the end of the log, or
+ *  at a record that is cut short or of an unknown type.
+ ***********************************************************/
+bool InputRecorder::ReadEvent(INPUT_EVENT& event)
+{
+	if ((!m_bReplaying) || (m_readOffset >= m_logBytes.size()))
+	{
+		return(false);
+	}
+
+	unsigned char type = m_logBytes[m_readOffset++];
+	unsigned long long x = 0;
+	unsigned long long y = 0;
+	unsigned long long keyState = 0;
+	event.keyState = 0;
+	switch (type)
+	{
+	case EVENT_FRAME:
+		if ((!ReadBytes(x, 4)) || (!ReadBytes(y, 4)) || (!ReadBytes(keyState, 4)))
+		{
+			return(false);
+		}
+		event.type = EVENT_FRAME;
+		event.x = BitsFloat((unsigned int)x);
+		event.y = BitsFloat((unsigned int)y);
+		event.keyState = (unsigned int)keyState;
+		m_frameCount++;
+		break;
+	case EVENT_CURSOR:
+	case EVENT_SCROLL:
+		if ((!ReadBytes(x, 8)) || (!ReadBytes(y, 8)))
+		{
+			return(false);
+		}
+		event.type = (EVENT_TYPE)type;
+		event.x = BitsDouble(x);
+		event.y = BitsDouble(y);
+		break;
+	default:
+		std::cout << "Unknown input log record:" << (int)type << std::endl;
+		m_readOffset = m_logBytes.size();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  HasNextFrame()
+ *
+ *  This method is used for checking, without reading them,
+ *  that the events left in the replayed log reach another
+ *  complete frame record, so a run can stop before starting
+ *  a frame the log has no input for.
+ ***********************************************************/
+bool InputRecorder::HasNextFrame() const
+{
+	if (!m_bReplaying)
+	{
+		return(false);
+	}
+
+	size_t offset = m_readOffset;
+	while (offset < m_logBytes.size())
+	{
+		unsigned char type = m_logBytes[offset++];
+		if (type == EVENT_FRAME)
+		{
+			return(offset + FRAME_PAYLOAD_BYTES <= m_logBytes.size());
+		}
+		if ((type != EVENT_CURSOR) && (type != EVENT_SCROLL))
+		{
+			return(false);
+		}
+		offset += POINTER_PAYLOAD_BYTES;
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  WriteBytes()
+ *
+ *  This method is used for writing the low bytes of a value
+ *  to the log, least significant first.
+ ***********************************************************/
+void InputRecorder::WriteBytes(unsigned long long value, int byteCount)
+{
+	for (int i = 0; i < byteCount; i++)
+	{
+		m_logFile.put((char)((value >> (i * 8)) & 0xFF));
+	}
+}
+
+/***********************************************************
+ *  ReadBytes()
+ *
+ *  This method is used for reading a little-endian value of
+ *  the passed in size from the replayed log.
+ ***********************************************************/
+bool InputRecorder::ReadBytes(unsigned long long& value, int byteCount)
+{
+	if (m_readOffset + byteCount > m_logBytes.size())
+	{
+		m_readOffset = m_logBytes.size();
+		return(false);
+	}
+
+	value = 0;
+	for (int i = 0; i < byteCount; i++)
+	{
+		value |= (unsigned long long)m_logBytes[m_readOffset++] << (i * 8);
+	}
+
+	return(true);
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.h
+// ============
+// record the input of a run to a binary log and read it back for replay
+//
+//  Every frame the view manager records the time since the last frame and
+//  the state of the keys it samples, and the mouse callbacks record each
+//  cursor move and scroll in between, in the order they arrive.  Replaying
+//  the log feeds the same events back in the same order with the recorded
+//  frame times instead of the clock, so the camera goes through the same
+//  states frame for frame.  The log is a small header followed by one
+//  record per event, a type byte and a little-endian payload:
+//
+//    frame    float seconds since recording started, float frame time,
+//             uint32 key state
+//    cursor   double x, double y
+//    scroll   double x offset, double y offset
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  This class contains the log file being recorded, or the
+ *  events of a log being replayed.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+	// constructor
+	InputRecorder();
+	// destructor
+	~InputRecorder();
+
+	enum EVENT_TYPE
+	{
+		EVENT_FRAME = 1,
+		EVENT_CURSOR,
+		EVENT_SCROLL
+	};
+
+	// event read back from a log
+	struct INPUT_EVENT
+	{
+		EVENT_TYPE type;
+		// frame: time since recording started and the frame time;
+		// cursor: position; scroll: offsets
+		double x;
+		double y;
+		// key state of a frame, one bit per sampled key
+		unsigned int keyState;
+	};
+
+	// create a log file and start recording into it
+	bool StartRecording(const char* filename);
+	// read a whole log file and start replaying it
+	bool StartReplay(const char* filename);
+	// close the log being recorded or drop the replayed events
+	void Stop();
+
+	bool IsRecording() const { return m_logFile.is_open(); }
+	bool IsReplaying() const { return m_bReplaying; }
+
+	void RecordFrame(float timestamp, float deltaTime, unsigned int keyState);
+	void RecordCursor(double x, double y);
+	void RecordScroll(double xOffset, double yOffset);
+
+	// read the next replayed event, false once the log is done
+	bool ReadEvent(INPUT_EVENT& event);
+	// true when the replayed log holds another complete frame
+	bool HasNextFrame() const;
+
+	// frames recorded, or replayed so far
+	int GetFrameCount() const { return m_frameCount; }
+
+private:
+	std::ofstream m_logFile;
+	// bytes of the replayed log and the read position
+	std::vector<unsigned char> m_logBytes;
+	size_t m_readOffset;
+	bool m_bReplaying;
+	int m_frameCount;
+
+	void WriteBytes(unsigned long long value, int byteCount);
+	bool ReadBytes(unsigned long long& value, int byteCount);
+};
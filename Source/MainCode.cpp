@@ -1,5 +1,8 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <string>           // command line arguments
+#include <chrono>           // CPU frame timing
+#include <algorithm>        // std::max
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +16,14 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "UniformCache.h"
+#include "TransformBenchmark.h"
+#include "ThreadPool.h"
+#include "FrameCapture.h"
+#include "FrameProfiler.h"
+#include "TraceRecorder.h"
+#include "CameraPath.h"
+#include "BenchmarkReport.h"
 
 // Namespace for declaring global variables
 namespace
@@ -20,6 +31,13 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// scene file loaded when none is passed on the command line
+	const char* const DEFAULT_SCENE_FILE = "scenes/breakfast.scene";
+
+	// longest an idle on-demand window sleeps before checking the
+	// scene for changes again
+	const double IDLE_WAIT_SECONDS = 0.5;
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -27,14 +45,25 @@ namespace
 	SceneManager* g_SceneManager = nullptr;
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
+	// uniform location cache for the loaded shader program
+	UniformCache* g_UniformCache = nullptr;
+	// shader manager object for the instanced shader program
+	ShaderManager* g_InstancedShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// worker threads for the scene update phase
+	ThreadPool* g_ThreadPool = nullptr;
+	// offscreen framebuffer the headless mode renders into
+	FrameCapture* g_FrameCapture = nullptr;
+	// CPU and GPU pass timers, reported on exit
+	FrameProfiler* g_FrameProfiler = nullptr;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
+bool InitializeGLFW(bool bHeadless);
 bool InitializeGLEW();
+const char* RenderModeName(SceneManager::RENDER_MODE renderMode, bool bUnsorted);
 
 
 /***********************************************************
@@ -45,8 +74,208 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	const char* sceneFilename = DEFAULT_SCENE_FILE;
+	// number of objects to generate instead of loading the scene file
+	int generatedObjects = 0;
+	unsigned int generatorSeed = 1;
+	// submit draws in scene table order instead of sorted by state
+	bool bUnsorted = false;
+	// how the scene objects are submitted
+	SceneManager::RENDER_MODE renderMode = SceneManager::RENDER_DRAW_LIST;
+	// draw every object instead of only those in view
+	bool bNoCulling = false;
+	// number of frames to render before closing, 0 runs until closed
+	int frameLimit = 0;
+	// number of transforms to compose in the transform benchmark,
+	// 0 renders the scene instead
+	int benchmarkTransforms = 0;
+	// worker threads for the scene update, -1 picks one per core
+	int workerThreads = -1;
+	// decode every texture instead of using the texture cache files
+	bool bNoTextureCache = false;
+	// upload textures as lossy BC1/BC3 blocks instead of
+	// uncompressed, when the driver supports S3TC
+	bool bTextureCompression = false;
+	// sample textures through bindless handles when supported
+	bool bBindlessTextures = false;
+	// video memory budget of streamed textures in MB, 0 keeps
+	// every texture fully resident
+	int textureBudgetMB = 0;
+	// render offscreen without a visible window and write every
+	// frame to an image file
+	bool bHeadless = false;
+	const char* outputPath = "frame.ppm";
+	int frameWidth = 1000;
+	int frameHeight = 800;
+	// time the passes of every frame and report their percentiles
+	bool bProfile = false;
+	// record a timeline of startup and every frame to a trace file
+	const char* tracePath = NULL;
+	// camera path played back at a fixed timestep instead of the
+	// live input, and the file the live camera is recorded to
+	const char* cameraPathFile = NULL;
+	const char* recordCameraFile = NULL;
+	float timestep = 1.0f / 60.0f;
+	// write the frame timings and counters of the run to a JSON
+	// benchmark report
+	const char* benchmarkReportFile = NULL;
+	// record the input of the run to a binary log, or replay one
+	// frame for frame instead of the live input
+	const char* recordInputFile = NULL;
+	const char* replayInputFile = NULL;
+	// only draw a frame when input, a resize or the scene has
+	// changed the view, instead of continuously
+	bool bOnDemand = false;
+
+	// parse the command line arguments
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if ((argument == "--scene") && (i + 1 < argc))
+		{
+			sceneFilename = argv[++i];
+		}
+		else if ((argument == "--generate") && (i + 1 < argc))
+		{
+			generatedObjects = std::atoi(argv[++i]);
+		}
+		else if ((argument == "--seed") && (i + 1 < argc))
+		{
+			generatorSeed = (unsigned int)std::atoi(argv[++i]);
+		}
+		else if (argument == "--unsorted")
+		{
+			bUnsorted = true;
+		}
+		else if (argument == "--instanced")
+		{
+			renderMode = SceneManager::RENDER_INSTANCED;
+		}
+		else if (argument == "--indirect")
+		{
+			renderMode = SceneManager::RENDER_INDIRECT;
+		}
+		else if (argument == "--no-cull")
+		{
+			bNoCulling = true;
+		}
+		else if ((argument == "--frames") && (i + 1 < argc))
+		{
+			frameLimit = std::atoi(argv[++i]);
+		}
+		else if ((argument == "--threads") && (i + 1 < argc))
+		{
+			workerThreads = std::atoi(argv[++i]);
+		}
+		else if (argument == "--no-texture-cache")
+		{
+			bNoTextureCache = true;
+		}
+		else if (argument == "--texture-compression")
+		{
+			bTextureCompression = true;
+		}
+		else if (argument == "--bindless")
+		{
+			bBindlessTextures = true;
+		}
+		else if ((argument == "--texture-budget") && (i + 1 < argc))
+		{
+			textureBudgetMB = std::atoi(argv[++i]);
+		}
+		else if (argument == "--headless")
+		{
+			bHeadless = true;
+		}
+		else if ((argument == "--output") && (i + 1 < argc))
+		{
+			outputPath = argv[++i];
+		}
+		else if ((argument == "--frame-size") && (i + 2 < argc))
+		{
+			frameWidth = std::max(std::atoi(argv[++i]), 1);
+			frameHeight = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (argument == "--profile")
+		{
+			bProfile = true;
+		}
+		else if (argument == "--on-demand")
+		{
+			bOnDemand = true;
+		}
+		else if ((argument == "--trace") && (i + 1 < argc))
+		{
+			tracePath = argv[++i];
+		}
+		else if ((argument == "--camera-path") && (i + 1 < argc))
+		{
+			cameraPathFile = argv[++i];
+		}
+		else if ((argument == "--record-camera") && (i + 1 < argc))
+		{
+			recordCameraFile = argv[++i];
+		}
+		else if ((argument == "--timestep") && (i + 1 < argc))
+		{
+			timestep = std::max((float)std::atof(argv[++i]), 0.0001f);
+		}
+		else if ((argument == "--record-input") && (i + 1 < argc))
+		{
+			recordInputFile = argv[++i];
+		}
+		else if ((argument == "--replay-input") && (i + 1 < argc))
+		{
+			replayInputFile = argv[++i];
+		}
+		else if ((argument == "--benchmark-report") && (i + 1 < argc))
+		{
+			benchmarkReportFile = argv[++i];
+		}
+		else if ((argument == "--bench-transforms") && (i + 1 < argc))
+		{
+			benchmarkTransforms = std::atoi(argv[++i]);
+		}
+	}
+
+	// the transform benchmark runs on the CPU only
+	if (benchmarkTransforms > 0)
+	{
+		RunTransformBenchmark(benchmarkTransforms, 1000);
+		return(EXIT_SUCCESS);
+	}
+
+	// recording starts before loading, so startup is traced too
+	TraceRecorder::SetThreadName("Main");
+	if (NULL != tracePath)
+	{
+		TraceRecorder::SetOutputPath(tracePath);
+		TraceRecorder::SetEnabled(true);
+	}
+
+	// a camera path is played back to its end unless told otherwise
+	CameraPath cameraPath;
+	if (NULL != cameraPathFile)
+	{
+		if (!cameraPath.Load(cameraPathFile))
+		{
+			return(EXIT_FAILURE);
+		}
+		if (frameLimit <= 0)
+		{
+			frameLimit = (int)(cameraPath.GetDuration() / timestep) + 1;
+		}
+	}
+
+	// a headless run renders a single frame unless told otherwise,
+	// or the whole of a replayed input log
+	if ((bHeadless) && (frameLimit <= 0) && (NULL == replayInputFile))
+	{
+		frameLimit = 1;
+	}
+
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	if (InitializeGLFW(bHeadless) == false)
 	{
 		return(EXIT_FAILURE);
 	}
@@ -57,8 +286,20 @@ int main(int argc, char* argv[])
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	// try to create the main display window, or the hidden
+	// window that owns the context in headless mode
+	if (bHeadless)
+	{
+		g_Window = g_ViewManager->CreateHeadlessWindow(WINDOW_TITLE, frameWidth, frameHeight);
+	}
+	else
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
+	if (NULL == g_Window)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -66,20 +307,179 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// headless frames are rendered into their own framebuffer
+	if (bHeadless)
+	{
+		g_FrameCapture = new FrameCapture();
+		if (!g_FrameCapture->Create(frameWidth, frameHeight))
+		{
+			return(EXIT_FAILURE);
+		}
+		g_FrameCapture->SetOutputPath(outputPath);
+	}
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
 		"../../../Utilities/shaders/vertexShader.glsl",
 		"../../../Utilities/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	// resolve the uniform locations of the active shader program once
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	g_UniformCache = new UniformCache((GLuint)programID);
+	g_ViewManager->SetUniformCache(g_UniformCache);
+
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager = new SceneManager(g_ShaderManager, g_UniformCache);
+	g_SceneManager->SetTextureCache(!bNoTextureCache);
+	g_SceneManager->SetTextureCompression(bTextureCompression);
+	g_SceneManager->SetBindlessTextures(bBindlessTextures);
+	g_SceneManager->SetTextureBudget((size_t)std::max(textureBudgetMB, 0) * 1024 * 1024);
+	{
+		TraceRecorder::ScopedEvent event("PrepareScene");
+		if (!g_SceneManager->PrepareScene(sceneFilename))
+		{
+			return(EXIT_FAILURE);
+		}
+		if (generatedObjects > 0)
+		{
+			g_SceneManager->GenerateScene(generatedObjects, generatorSeed);
+		}
+	}
+	g_SceneManager->SetDrawListSorting(!bUnsorted);
+	g_SceneManager->SetFrustumCulling(!bNoCulling);
+
+	// the update phase runs on the workers, GL calls stay on this thread
+	if (workerThreads < 0)
+	{
+		workerThreads = ThreadPool::GetDefaultWorkerCount();
+	}
+	g_ThreadPool = new ThreadPool(workerThreads);
+	g_SceneManager->SetThreadPool(g_ThreadPool);
+
+	// the passes of the frame loop are timed on request
+	int frameTimer = -1;
+	int viewTimer = -1;
+	int updateTimer = -1;
+	int renderTimer = -1;
+	int presentTimer = -1;
+	if (bProfile)
+	{
+		g_FrameProfiler = new FrameProfiler();
+		if (!g_FrameProfiler->IsGPUTimingSupported())
+		{
+			std::cout << "INFO: Timer queries are not supported, profiling the CPU only" << std::endl;
+		}
+		frameTimer = g_FrameProfiler->AddTimer("Frame", true);
+		viewTimer = g_FrameProfiler->AddTimer("PrepareSceneView", true);
+		updateTimer = g_FrameProfiler->AddTimer("UpdateScene", false);
+		renderTimer = g_FrameProfiler->AddTimer("RenderScene", true);
+		presentTimer = g_FrameProfiler->AddTimer(bHeadless ? "CaptureFrame" : "SwapBuffers", true);
+		g_SceneManager->SetProfiler(g_FrameProfiler);
+	}
+
+	// load the instanced shader code for the instanced render modes
+	if (renderMode != SceneManager::RENDER_DRAW_LIST)
+	{
+		g_InstancedShaderManager = new ShaderManager();
+		g_InstancedShaderManager->LoadShaders(
+			"shaders/instancedVertexShader.glsl",
+			"shaders/instancedFragmentShader.glsl");
+		if ((!g_SceneManager->SetInstancedShader(g_InstancedShaderManager)) ||
+			(!g_SceneManager->SetRenderMode(renderMode)))
+		{
+			std::cout << "INFO: Falling back to the draw list render mode" << std::endl;
+			renderMode = SceneManager::RENDER_DRAW_LIST;
+		}
+	}
+
+	// the camera follows the path instead of the input
+	if (!cameraPath.IsEmpty())
+	{
+		g_ViewManager->SetCameraPath(&cameraPath, timestep);
+	}
+	// otherwise the input is replayed from a log, or recorded
+	else if (NULL != replayInputFile)
+	{
+		if (!g_ViewManager->StartInputReplay(replayInputFile))
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	else if (NULL != recordInputFile)
+	{
+		if (!g_ViewManager->StartInputRecording(recordInputFile))
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	// benchmark frames are not held back by the display refresh
+	if ((NULL != benchmarkReportFile) && (!bHeadless))
+	{
+		glfwSwapInterval(0);
+	}
+	BenchmarkReport benchmarkReport;
+	CameraPath recordedPath;
+	double recordStart = glfwGetTime();
+
+	// totals used for the frame report printed on exit
+	int renderedFrames = 0;
+	double totalFrameMilliseconds = 0.0;
+	double totalUpdateMilliseconds = 0.0;
+	long long totalStateChanges = 0;
+	long long totalSkippedChanges = 0;
+	long long totalDrawCalls = 0;
+	long long totalVisibleObjects = 0;
+	long long totalCulledObjects = 0;
+	size_t peakTextureBytes = 0;
+	size_t lastTextureBytes = 0;
+	long long totalTexturesStreamed = 0;
+	long long totalTexturesEvicted = 0;
+	// a headless run has no events to wait for
+	if ((bOnDemand) && (bHeadless))
+	{
+		bOnDemand = false;
+	}
+	int idleWaits = 0;
+	double runStart = glfwGetTime();
+	double runStartCPUSeconds = BenchmarkReport::GetProcessCPUSeconds();
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// a replayed input log ends the run after its last
+		// recorded frame, before another frame is started
+		if (g_ViewManager->IsInputReplayDone())
+		{
+			break;
+		}
+
+		// an unchanged view is not drawn again, the loop sleeps
+		// until the next event instead
+		if ((bOnDemand) && (!g_ViewManager->IsViewDirty()) && (!g_SceneManager->NeedsRedraw()))
+		{
+			TraceRecorder::ScopedEvent event("WaitForEvents");
+			g_ViewManager->WaitForEvents(IDLE_WAIT_SECONDS);
+			idleWaits++;
+			continue;
+		}
+
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		TraceRecorder::BeginEvent("Frame");
+
+		if (NULL != g_FrameProfiler)
+		{
+			g_FrameProfiler->BeginFrame();
+			g_FrameProfiler->Begin(frameTimer);
+		}
+
+		if (NULL != g_FrameCapture)
+		{
+			g_FrameCapture->Bind();
+		}
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -87,31 +487,231 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// reset the per-frame uniform lookup counter
+		g_UniformCache->BeginFrame();
+
 		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		{
+			FrameProfiler::ScopedTimer timer(g_FrameProfiler, viewTimer);
+			TraceRecorder::ScopedEvent event("PrepareSceneView");
+			g_ViewManager->PrepareSceneView();
+		}
+		if (NULL != recordCameraFile)
+		{
+			recordedPath.AddKeyframe(g_ViewManager->GetCameraKeyframe((float)(glfwGetTime() - recordStart)));
+		}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// update the 3D scene in parallel, then submit it
+		g_SceneManager->SetViewParameters(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(),
+			g_ViewManager->GetCameraPosition(),
+			g_ViewManager->GetFrameHeight());
+		{
+			FrameProfiler::ScopedTimer timer(g_FrameProfiler, updateTimer);
+			TraceRecorder::ScopedEvent event("UpdateScene");
+			g_SceneManager->UpdateScene();
+		}
+		{
+			FrameProfiler::ScopedTimer timer(g_FrameProfiler, renderTimer);
+			TraceRecorder::ScopedEvent event("RenderScene");
+			g_SceneManager->RenderScene();
+		}
 
+		// accumulate the CPU time and state changes of this frame
+		auto frameEnd = std::chrono::high_resolution_clock::now();
+		const SceneManager::FRAME_STATS& frameStats = g_SceneManager->GetFrameStats();
+		double cpuFrameMilliseconds = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+		totalFrameMilliseconds += cpuFrameMilliseconds;
+		totalUpdateMilliseconds += frameStats.updateMilliseconds;
+		totalStateChanges += frameStats.stateChangesSubmitted;
+		totalSkippedChanges += frameStats.stateChangesSkipped;
+		totalDrawCalls += frameStats.drawCalls;
+		totalVisibleObjects += frameStats.visibleObjects;
+		totalCulledObjects += frameStats.culledObjects;
+		peakTextureBytes = std::max(peakTextureBytes, frameStats.textureResidentBytes);
+		lastTextureBytes = frameStats.textureResidentBytes;
+		totalTexturesStreamed += frameStats.texturesStreamed;
+		totalTexturesEvicted += frameStats.texturesEvicted;
+		renderedFrames++;
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		// write the headless frame, or flip the back buffer with the
+		// front buffer every frame
+		{
+			FrameProfiler::ScopedTimer timer(g_FrameProfiler, presentTimer);
+			TraceRecorder::ScopedEvent event((NULL != g_FrameCapture) ? "CaptureFrame" : "SwapBuffers");
+			if (NULL != g_FrameCapture)
+			{
+				g_FrameCapture->CaptureFrame(renderedFrames - 1);
+			}
+			else
+			{
+				glfwSwapBuffers(g_Window);
+			}
+		}
+
+		if (NULL != g_FrameProfiler)
+		{
+			g_FrameProfiler->End(frameTimer);
+			g_FrameProfiler->EndFrame();
+		}
 
 		// query the latest GLFW events
 		glfwPollEvents();
+		TraceRecorder::EndEvent("Frame");
+
+		if (NULL != benchmarkReportFile)
+		{
+			auto frameDone = std::chrono::high_resolution_clock::now();
+			BenchmarkReport::FRAME_SAMPLE sample;
+			sample.frameMilliseconds = std::chrono::duration<float, std::milli>(frameDone - frameStart).count();
+			sample.cpuMilliseconds = (float)cpuFrameMilliseconds;
+			sample.updateMilliseconds = frameStats.updateMilliseconds;
+			sample.drawCalls = frameStats.drawCalls;
+			sample.stateChanges = frameStats.stateChangesSubmitted;
+			sample.stateChangesSkipped = frameStats.stateChangesSkipped;
+			sample.visibleObjects = frameStats.visibleObjects;
+			sample.culledObjects = frameStats.culledObjects;
+			sample.textureResidentBytes = frameStats.textureResidentBytes;
+			benchmarkReport.AddFrame(sample);
+		}
+
+		if ((frameLimit > 0) && (renderedFrames >= frameLimit))
+		{
+			glfwSetWindowShouldClose(g_Window, true);
+		}
+	}
+
+	// write the headless frames still being read back
+	if (NULL != g_FrameCapture)
+	{
+		g_FrameCapture->Finish();
+	}
+
+	// report how much of a core the run kept busy, so idle use
+	// can be compared with and without on-demand rendering
+	double runSeconds = glfwGetTime() - runStart;
+	if (runSeconds > 0.0)
+	{
+		double cpuSeconds = BenchmarkReport::GetProcessCPUSeconds() - runStartCPUSeconds;
+		std::cout << "INFO: CPU usage: " << 100.0 * cpuSeconds / runSeconds << "% of a core over "
+			<< runSeconds << " s" << std::endl;
+		if (bOnDemand)
+		{
+			std::cout << "INFO: On-demand rendering drew " << renderedFrames << " frames and waited idle "
+				<< idleWaits << " times" << std::endl;
+		}
+	}
+
+	// report the average per-frame cost of the scene
+	if (renderedFrames > 0)
+	{
+		std::cout << "INFO: Rendered " << renderedFrames << " frames of "
+			<< g_SceneManager->GetObjectCount() << " objects ("
+			<< RenderModeName(renderMode, bUnsorted) << ")" << std::endl;
+		std::cout << "INFO: Average CPU frame time: " << totalFrameMilliseconds / renderedFrames << " ms" << std::endl;
+		std::cout << "INFO: Average update time: " << totalUpdateMilliseconds / renderedFrames
+			<< " ms on " << g_ThreadPool->GetWorkerCount() + 1 << " threads, "
+			<< g_ThreadPool->GetStolenCount() << " chunks stolen in total" << std::endl;
+		std::cout << "INFO: Average draw calls: " << totalDrawCalls / renderedFrames
+			<< ", state changes: " << totalStateChanges / renderedFrames
+			<< ", skipped: " << totalSkippedChanges / renderedFrames << std::endl;
+		std::cout << "INFO: Average visible objects: " << totalVisibleObjects / renderedFrames
+			<< ", culled: " << totalCulledObjects / renderedFrames << std::endl;
+		if (NULL != g_FrameCapture)
+		{
+			std::cout << "INFO: Wrote " << g_FrameCapture->GetWrittenCount() << " frames of "
+				<< frameWidth << "x" << frameHeight << " to " << g_FrameCapture->GetFramePath(0)
+				<< " onwards" << std::endl;
+			std::cout << "INFO: Average readback stall: " << g_FrameCapture->GetStallMilliseconds() / renderedFrames
+				<< " ms" << std::endl;
+		}
+		if (textureBudgetMB > 0)
+		{
+			std::cout << "INFO: Resident texture memory: " << lastTextureBytes / 1024
+				<< " KB, peak: " << peakTextureBytes / 1024 << " KB of " << textureBudgetMB * 1024
+				<< " KB budget, streamed: " << totalTexturesStreamed
+				<< ", evicted: " << totalTexturesEvicted << std::endl;
+		}
+		if (NULL != g_FrameProfiler)
+		{
+			g_FrameProfiler->Report(std::cout);
+		}
+	}
+
+	// write the benchmark report of the run
+	if (NULL != benchmarkReportFile)
+	{
+		benchmarkReport.SetProperty("scene", (generatedObjects > 0) ? std::string("generated") : std::string(sceneFilename));
+		benchmarkReport.SetProperty("seed", generatorSeed);
+		benchmarkReport.SetProperty("objects", g_SceneManager->GetObjectCount());
+		benchmarkReport.SetProperty("renderMode", RenderModeName(renderMode, bUnsorted));
+		benchmarkReport.SetProperty("cameraPath", (NULL != cameraPathFile) ? cameraPathFile : "");
+		benchmarkReport.SetProperty("timestep", timestep);
+		benchmarkReport.SetProperty("frameWidth", g_ViewManager->GetFrameWidth());
+		benchmarkReport.SetProperty("frameHeight", g_ViewManager->GetFrameHeight());
+		benchmarkReport.SetProperty("threads", g_ThreadPool->GetWorkerCount() + 1);
+		benchmarkReport.SetProperty("headless", bHeadless ? 1 : 0);
+		benchmarkReport.SetProperty("textureBudgetMB", textureBudgetMB);
+		if (benchmarkReport.Write(benchmarkReportFile))
+		{
+			std::cout << "INFO: Wrote the benchmark report of " << benchmarkReport.GetFrameCount()
+				<< " frames to " << benchmarkReportFile << std::endl;
+		}
+	}
+
+	// save the camera path flown in this run
+	if ((NULL != recordCameraFile) && (recordedPath.Save(recordCameraFile)))
+	{
+		std::cout << "INFO: Recorded " << recordedPath.GetKeyframeCount() << " camera keyframes to "
+			<< recordCameraFile << std::endl;
+	}
+
+	// close the input log of this run
+	g_ViewManager->StopInput();
+
+	// write the timeline of the whole run
+	if (TraceRecorder::IsEnabled())
+	{
+		TraceRecorder::WriteTrace();
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_FrameCapture)
+	{
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
 	if (NULL != g_ViewManager)
 	{
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_ThreadPool)
+	{
+		delete g_ThreadPool;
+		g_ThreadPool = NULL;
+	}
+	if (NULL != g_InstancedShaderManager)
+	{
+		delete g_InstancedShaderManager;
+		g_InstancedShaderManager = NULL;
+	}
+	if (NULL != g_UniformCache)
+	{
+		delete g_UniformCache;
+		g_UniformCache = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
@@ -125,13 +725,49 @@ int main(int argc, char* argv[])
 /***********************************************************
  *	InitializeGLFW()
  * 
- *  This function is used to initialize the GLFW library.   
+ *  This function is used to initialize the GLFW library.
+ *  Rendering without a display needs GLEW built with
+ *  GLEW_OSMESA, which loads the OpenGL functions through
+ *  OSMesa; the headless window then gets a software OSMesa
+ *  context on the GLFW null platform.  A stock GLEW loads
+ *  through GLX and can only be used with a display.
  ***********************************************************/
-bool InitializeGLFW()
+bool InitializeGLFW(bool bHeadless)
 {
 	// GLFW: initialize and configure library
 	// --------------------------------------
-	glfwInit();
+#if defined(GLEW_OSMESA)
+	// this GLEW cannot load functions for a native context
+	if (!bHeadless)
+	{
+		std::cout << "GLEW was built with GLEW_OSMESA, so only --headless runs are supported" << std::endl;
+		return(false);
+	}
+#if (GLFW_VERSION_MAJOR > 3) || ((GLFW_VERSION_MAJOR == 3) && (GLFW_VERSION_MINOR >= 4))
+	if (!glfwPlatformSupported(GLFW_PLATFORM_NULL))
+	{
+		std::cout << "GLFW was built without the null platform needed by OSMesa" << std::endl;
+		return(false);
+	}
+	glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+	std::cout << "Headless rendering through OSMesa needs GLFW 3.4 or later" << std::endl;
+	return(false);
+#endif
+#elif !defined(_WIN32) && !defined(__APPLE__)
+	// a stock GLEW finds no GLX display to load functions from
+	bool bHasDisplay = (NULL != std::getenv("DISPLAY")) || (NULL != std::getenv("WAYLAND_DISPLAY"));
+	if ((bHeadless) && (!bHasDisplay))
+	{
+		std::cout << "Headless rendering without a display needs GLEW built with GLEW_OSMESA" << std::endl;
+		return(false);
+	}
+#endif
+	if (!glfwInit())
+	{
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return(false);
+	}
 
 #ifdef __APPLE__
 	// set the version of OpenGL and profile to use
@@ -139,9 +775,10 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #else
-	// set the version of OpenGL and profile to use
+	// set the version of OpenGL and profile to use, software
+	// renderers used headless go up to 4.5
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, bHeadless ? 5 : 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
 	// GLFW: end -------------------------------
@@ -174,4 +811,25 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
+}
+
+/***********************************************************
+ *	RenderModeName()
+ *
+ *  This function is used to describe the render mode in
+ *  the frame report.
+ ***********************************************************/
+const char* RenderModeName(SceneManager::RENDER_MODE renderMode, bool bUnsorted)
+{
+	switch (renderMode)
+	{
+	case SceneManager::RENDER_INSTANCED:
+		return("instanced");
+	case SceneManager::RENDER_INDIRECT:
+		return("multi-draw indirect");
+	default:
+		break;
+	}
+
+	return(bUnsorted ? "unsorted draw list" : "sorted draw list");
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// read only memory mapping of a whole file
+//
+//  Uses MapViewOfFile on Windows and mmap elsewhere, so the contents of a
+//  file can be read, hashed or uploaded without copying them into a
+//  separate buffer first.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class contains the handles and view of one file
+ *  mapped into memory for reading.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the whole file, returns false when it cannot be opened
+	bool Open(const char* filename);
+	// unmap the file and close its handles
+	void Close();
+
+	bool IsOpen() const { return (NULL != m_pData); }
+	const unsigned char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	const unsigned char* m_pData;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+
+	// mappings are not copyable
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -0,0 +1,326 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the scene objects for frustum culling
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of the global variables and defines
+namespace
+{
+	// largest number of objects stored in a leaf node
+	const int MAX_LEAF_OBJECTS = 4;
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+}
+
+/***********************************************************
+ *  ~SceneBVH()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBVH::~SceneBVH()
+{
+	m_nodes.clear();
+	m_objectIndices.clear();
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This method is used for extracting the six planes of the
+ *  view frustum from the combined view projection matrix.
+ *  Each plane is a sum or difference of the matrix rows and
+ *  is normalized so distances are in world units.
+ ***********************************************************/
+SceneBVH::FRUSTUM SceneBVH::ExtractFrustum(const glm::mat4& viewProjection)
+{
+	// glm matrices are column major, so gather the rows
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	FRUSTUM frustum;
+	frustum.planes[0] = rows[3] + rows[0]; // left
+	frustum.planes[1] = rows[3] - rows[0]; // right
+	frustum.planes[2] = rows[3] + rows[1]; // bottom
+	frustum.planes[3] = rows[3] - rows[1]; // top
+	frustum.planes[4] = rows[3] + rows[2]; // near
+	frustum.planes[5] = rows[3] - rows[2]; // far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(frustum.planes[i].x, frustum.planes[i].y, frustum.planes[i].z));
+		if (length > 0.0f)
+		{
+			frustum.planes[i] = frustum.planes[i] / length;
+		}
+	}
+
+	return(frustum);
+}
+
+/***********************************************************
+ *  TransformBox()
+ *
+ *  This method is used for transforming an object space
+ *  box by a model matrix into the world space box that
+ *  encloses it.
+ ***********************************************************/
+SceneBVH::BOUNDING_BOX SceneBVH::TransformBox(const BOUNDING_BOX& box, const glm::mat4& modelMatrix)
+{
+	glm::vec3 center = (box.boundsMin + box.boundsMax) * 0.5f;
+	glm::vec3 extent = (box.boundsMax - box.boundsMin) * 0.5f;
+
+	glm::vec4 worldCenter = modelMatrix * glm::vec4(center, 1.0f);
+	glm::vec3 worldExtent(0.0f, 0.0f, 0.0f);
+	for (int row = 0; row < 3; row++)
+	{
+		worldExtent[row] =
+			fabsf(modelMatrix[0][row]) * extent.x +
+			fabsf(modelMatrix[1][row]) * extent.y +
+			fabsf(modelMatrix[2][row]) * extent.z;
+	}
+
+	BOUNDING_BOX worldBox;
+	worldBox.boundsMin = glm::vec3(worldCenter.x, worldCenter.y, worldCenter.z) - worldExtent;
+	worldBox.boundsMax = glm::vec3(worldCenter.x, worldCenter.y, worldCenter.z) + worldExtent;
+
+	return(worldBox);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the hierarchy over the
+ *  passed in object boxes.
+ ***********************************************************/
+void SceneBVH::Build(const std::vector<BOUNDING_BOX>& objectBoxes)
+{
+	m_nodes.clear();
+	m_objectBoxes = objectBoxes;
+	m_objectIndices.resize(objectBoxes.size());
+	m_centers.resize(objectBoxes.size());
+	for (int i = 0; i < (int)objectBoxes.size(); i++)
+	{
+		m_objectIndices[i] = i;
+		m_centers[i] = (objectBoxes[i].boundsMin + objectBoxes[i].boundsMax) * 0.5f;
+	}
+
+	if (objectBoxes.size() > 0)
+	{
+		m_nodes.reserve(2 * objectBoxes.size() / MAX_LEAF_OBJECTS + 1);
+		BuildNode(0, (int)objectBoxes.size());
+	}
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for building the node that covers a
+ *  range of objects.  Ranges larger than a leaf are split at
+ *  the median object center along the longest axis.
+ ***********************************************************/
+int SceneBVH::BuildNode(int firstObject, int objectCount)
+{
+	int nodeIndex = (int)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+
+	// bounds of the objects and of their centers
+	BOUNDING_BOX bounds = m_objectBoxes[m_objectIndices[firstObject]];
+	glm::vec3 centerMin = m_centers[m_objectIndices[firstObject]];
+	glm::vec3 centerMax = centerMin;
+	for (int i = firstObject + 1; i < firstObject + objectCount; i++)
+	{
+		int objectIndex = m_objectIndices[i];
+		bounds.boundsMin = glm::min(bounds.boundsMin, m_objectBoxes[objectIndex].boundsMin);
+		bounds.boundsMax = glm::max(bounds.boundsMax, m_objectBoxes[objectIndex].boundsMax);
+		centerMin = glm::min(centerMin, m_centers[objectIndex]);
+		centerMax = glm::max(centerMax, m_centers[objectIndex]);
+	}
+	m_nodes[nodeIndex].bounds = bounds;
+
+	if (objectCount <= MAX_LEAF_OBJECTS)
+	{
+		m_nodes[nodeIndex].rightChild = -1;
+		m_nodes[nodeIndex].firstObject = firstObject;
+		m_nodes[nodeIndex].objectCount = objectCount;
+		return(nodeIndex);
+	}
+
+	// split along the axis with the widest spread of centers
+	glm::vec3 spread = centerMax - centerMin;
+	int axis = 0;
+	if (spread.y > spread[axis]) axis = 1;
+	if (spread.z > spread[axis]) axis = 2;
+
+	int half = objectCount / 2;
+	std::nth_element(
+		m_objectIndices.begin() + firstObject,
+		m_objectIndices.begin() + firstObject + half,
+		m_objectIndices.begin() + firstObject + objectCount,
+		[this, axis](int a, int b)
+		{
+			return(m_centers[a][axis] < m_centers[b][axis]);
+		});
+
+	m_nodes[nodeIndex].firstObject = firstObject;
+	m_nodes[nodeIndex].objectCount = objectCount;
+	BuildNode(firstObject, half);
+	int rightChild = BuildNode(firstObject + half, objectCount - half);
+	m_nodes[nodeIndex].rightChild = rightChild;
+
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  TestBox()
+ *
+ *  This method is used for classifying a box as outside,
+ *  intersecting, or fully inside the frustum.
+ ***********************************************************/
+SceneBVH::CULL_RESULT SceneBVH::TestBox(const FRUSTUM& frustum, const BOUNDING_BOX& box)
+{
+	glm::vec3 center = (box.boundsMin + box.boundsMax) * 0.5f;
+	glm::vec3 extent = (box.boundsMax - box.boundsMin) * 0.5f;
+	CULL_RESULT result = CULL_INSIDE;
+
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float radius = fabsf(plane.x) * extent.x + fabsf(plane.y) * extent.y + fabsf(plane.z) * extent.z;
+
+		if (distance + radius < 0.0f)
+		{
+			return(CULL_OUTSIDE);
+		}
+		if (distance - radius < 0.0f)
+		{
+			result = CULL_INTERSECTS;
+		}
+	}
+
+	return(result);
+}
+
+/***********************************************************
+ *  GetSubtrees()
+ *
+ *  This method is used for splitting the hierarchy into
+ *  subtrees that can be culled on separate threads.  Inner
+ *  nodes are replaced by their children in place, keeping
+ *  the subtrees in depth first order.  A subtree is culled
+ *  the same without its ancestors, since its bounds lie
+ *  within theirs.
+ ***********************************************************/
+void SceneBVH::GetSubtrees(int minimumCount, std::vector<int>& subtreeNodes) const
+{
+	subtreeNodes.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	subtreeNodes.push_back(0);
+	bool bSplit = true;
+	while ((bSplit) && ((int)subtreeNodes.size() < minimumCount))
+	{
+		bSplit = false;
+		std::vector<int> nextNodes;
+		for (int nodeIndex : subtreeNodes)
+		{
+			if (m_nodes[nodeIndex].rightChild < 0)
+			{
+				nextNodes.push_back(nodeIndex);
+			}
+			else
+			{
+				nextNodes.push_back(nodeIndex + 1);
+				nextNodes.push_back(m_nodes[nodeIndex].rightChild);
+				bSplit = true;
+			}
+		}
+		subtreeNodes.swap(nextNodes);
+	}
+}
+
+/***********************************************************
+ *  CollectSubtree()
+ *
+ *  This method is used for collecting the visible objects
+ *  below one node returned by GetSubtrees.
+ ***********************************************************/
+void SceneBVH::CollectSubtree(int subtreeNode, const FRUSTUM& frustum, std::vector<int>& visibleObjects) const
+{
+	if ((subtreeNode >= 0) && (subtreeNode < (int)m_nodes.size()))
+	{
+		CollectNode(subtreeNode, frustum, visibleObjects);
+	}
+}
+
+/***********************************************************
+ *  CollectAll()
+ *
+ *  This method is used for adding every object below a node
+ *  that is fully inside the frustum.
+ ***********************************************************/
+void SceneBVH::CollectAll(int nodeIndex, std::vector<int>& visibleObjects) const
+{
+	const BVH_NODE& node = m_nodes[nodeIndex];
+	visibleObjects.insert(
+		visibleObjects.end(),
+		m_objectIndices.begin() + node.firstObject,
+		m_objectIndices.begin() + node.firstObject + node.objectCount);
+}
+
+/***********************************************************
+ *  CollectNode()
+ *
+ *  This method is used for testing a node against the
+ *  frustum and descending into the children it intersects.
+ *  The objects of an intersected leaf are tested one by one.
+ ***********************************************************/
+void SceneBVH::CollectNode(int nodeIndex, const FRUSTUM& frustum, std::vector<int>& visibleObjects) const
+{
+	const BVH_NODE& node = m_nodes[nodeIndex];
+	CULL_RESULT result = TestBox(frustum, node.bounds);
+
+	if (result == CULL_OUTSIDE)
+	{
+		return;
+	}
+	if (result == CULL_INSIDE)
+	{
+		CollectAll(nodeIndex, visibleObjects);
+		return;
+	}
+	if (node.rightChild < 0)
+	{
+		for (int i = node.firstObject; i < node.firstObject + node.objectCount; i++)
+		{
+			int objectIndex = m_objectIndices[i];
+			if (TestBox(frustum, m_objectBoxes[objectIndex]) != CULL_OUTSIDE)
+			{
+				visibleObjects.push_back(objectIndex);
+			}
+		}
+		return;
+	}
+
+	CollectNode(nodeIndex + 1, frustum, visibleObjects);
+	CollectNode(node.rightChild, frustum, visibleObjects);
+}
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the scene objects for frustum culling
+//
+//  The hierarchy is built over the world space bounding boxes of the scene
+//  objects.  Whole subtrees outside the view frustum are rejected with one
+//  test, and subtrees fully inside are accepted without testing their
+//  objects.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class contains the hierarchy nodes and the methods
+ *  for building it and collecting the visible objects.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+	// destructor
+	~SceneBVH();
+
+	// axis aligned bounding box in world space
+	struct BOUNDING_BOX
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// the six planes of a view frustum, each plane stored as
+	// xyz normal pointing inward and w distance
+	struct FRUSTUM
+	{
+		glm::vec4 planes[6];
+	};
+
+	// extract the frustum planes from a view projection matrix
+	static FRUSTUM ExtractFrustum(const glm::mat4& viewProjection);
+	// transform an object space box into a world space box
+	static BOUNDING_BOX TransformBox(const BOUNDING_BOX& box, const glm::mat4& modelMatrix);
+
+	// build the hierarchy over the passed in object boxes,
+	// the box index is the object index
+	void Build(const std::vector<BOUNDING_BOX>& objectBoxes);
+	// split the hierarchy into at least a number of subtrees,
+	// in depth first order
+	void GetSubtrees(int minimumCount, std::vector<int>& subtreeNodes) const;
+	// collect the indices of the objects of one subtree inside
+	// the frustum, appending them to the passed in list
+	void CollectSubtree(int subtreeNode, const FRUSTUM& frustum, std::vector<int>& visibleObjects) const;
+
+	// number of objects the hierarchy was built over
+	int GetObjectCount() const { return (int)m_objectIndices.size(); }
+
+private:
+	struct BVH_NODE
+	{
+		BOUNDING_BOX bounds;
+		// children of an inner node, the right child is stored
+		// at rightChild and the left child right after the node
+		int rightChild;
+		// object range of a leaf node within m_objectIndices
+		int firstObject;
+		int objectCount;
+	};
+
+	// result of testing a box against the frustum
+	enum CULL_RESULT
+	{
+		CULL_OUTSIDE = 0,
+		CULL_INTERSECTS,
+		CULL_INSIDE
+	};
+
+	// hierarchy nodes, the root is node 0
+	std::vector<BVH_NODE> m_nodes;
+	// object indices, grouped so every leaf owns a range
+	std::vector<int> m_objectIndices;
+	// boxes of the objects, indexed by object index
+	std::vector<BOUNDING_BOX> m_objectBoxes;
+	// centers of the object boxes, used while building
+	std::vector<glm::vec3> m_centers;
+
+	// build the node for a range of m_objectIndices
+	int BuildNode(int firstObject, int objectCount);
+	// test a box against the frustum
+	static CULL_RESULT TestBox(const FRUSTUM& frustum, const BOUNDING_BOX& box);
+	// add every object below a node without testing
+	void CollectAll(int nodeIndex, std::vector<int>& visibleObjects) const;
+	// test a node and its children against the frustum
+	void CollectNode(int nodeIndex, const FRUSTUM& frustum, std::vector<int>& visibleObjects) const;
+};
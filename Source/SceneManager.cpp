@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "TraceRecorder.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,6 +17,12 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+
 // declaration of global variables
 namespace
 {
@@ -24,6 +31,35 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_MaterialIndexName = "materialIndex";
+	const char* g_MaterialBlockName = "MaterialBlock";
+	const char* g_TextureIndexName = "textureIndex";
+	const char* g_UseBindlessName = "bUseBindlessTextures";
+
+	// uniform buffer binding point and capacity of the material block
+	const GLuint MATERIAL_BLOCK_BINDING = 1;
+	const int MAX_BLOCK_MATERIALS = 256;
+	// bindless texture handles stored after the materials, one
+	// uvec4 per texture slot to match the std140 array stride
+	const int MAX_BLOCK_TEXTURES = 256;
+	const int BLOCK_HANDLE_WORDS = 4;
+	const size_t BLOCK_HANDLES_OFFSET = MAX_BLOCK_MATERIALS * sizeof(SceneManager::MATERIAL_BLOCK_ENTRY);
+	const size_t MATERIAL_BLOCK_SIZE = BLOCK_HANDLES_OFFSET + (MAX_BLOCK_TEXTURES * BLOCK_HANDLE_WORDS * sizeof(GLuint));
+
+	// texture unit the draw list binds each object texture to,
+	// and the first unit of the array textures
+	const int LEGACY_TEXTURE_UNIT = 0;
+	const int ARRAY_TEXTURE_UNIT_BASE = 1;
+
+	// objects per task of the parallel update phase, and the
+	// number of hierarchy subtrees culled per thread
+	const int TRANSFORM_CHUNK_SIZE = 1024;
+	const int SORT_KEY_CHUNK_SIZE = 2048;
+	const int CULL_SUBTREES_PER_THREAD = 4;
+	// fewest objects per culled subtree, smaller scenes are
+	// culled on the calling thread without waking the workers
+	const int CULL_OBJECTS_PER_SUBTREE = 1024;
 }
 
 /***********************************************************
@@ -31,10 +67,41 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, UniformCache *pUniformCache)
 {
 	m_pShaderManager = pShaderManager;
+	m_pUniformCache = pUniformCache;
+	m_materialBuffer = 0;
+	m_bMaterialBufferActive = false;
+	m_bSortDrawList = true;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+	m_pInstancedShader = NULL;
+	m_pInstancedUniforms = NULL;
+	m_instancedViewUniform = UniformCache::INVALID_HANDLE;
+	m_instancedProjectionUniform = UniformCache::INVALID_HANDLE;
+	m_instancedViewPositionUniform = UniformCache::INVALID_HANDLE;
+	m_renderMode = RENDER_DRAW_LIST;
+	m_bBVHDirty = true;
+	m_bSceneChanged = true;
+	m_bFrustumCulling = true;
+	m_pThreadPool = NULL;
+	m_bUseTextureCache = true;
+	m_bCompressTextures = false;
+	m_bBindlessTextures = false;
+	m_bBindlessTexturesActive = false;
+	m_viewportHeight = 0;
+	m_pProfiler = NULL;
+	m_residencyTimer = -1;
+	m_textureBindTimer = -1;
+	for (int i = 0; i <= RENDER_INDIRECT; i++)
+	{
+		m_renderTimers[i] = -1;
+	}
+	ResolveUniforms();
 	m_basicMeshes = new ShapeMeshes();
+	m_frameStats = FRAME_STATS();
 }
 
 /***********************************************************
@@ -44,238 +111,957 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	DestroyGLTextures();
 	m_pShaderManager = NULL;
+	m_pUniformCache = NULL;
+	m_pInstancedShader = NULL;
+	if (NULL != m_pInstancedUniforms)
+	{
+		delete m_pInstancedUniforms;
+		m_pInstancedUniforms = NULL;
+	}
+	m_shapeBuffer.Destroy();
+	if (0 != m_materialBuffer)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
 }
 
 /***********************************************************
- *  CreateGLTexture()
+ *  CreateGLTextures()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for loading every image file queued
+ *  in the passed in loader.  The files are decoded on the
+ *  loader threads, so the load time is bounded by the
+ *  slowest decode instead of their sum.  When array
+ *  textures are supported the images are packed into them
+ *  once every decode is done; otherwise each image is
+ *  uploaded on its own as soon as its decode finishes.
+ *  When textures are streamed only the tail of each mip
+ *  chain is uploaded, and the images are kept for the
+ *  residency manager to stream the finer levels from.
+ *  The textures are registered in request order, so the
+ *  slots do not depend on which decode finished first.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+void SceneManager::CreateGLTextures(TextureLoader& loader)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	TraceRecorder::ScopedEvent event("CreateGLTextures");
+	auto loadStart = std::chrono::high_resolution_clock::now();
 
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
+	int requestCount = loader.GetRequestCount();
+	std::vector<TextureLoader::DECODED_IMAGE> images(requestCount);
+	std::vector<TextureArrayManager::TEXTURE_LOCATION> locations(requestCount);
+	for (TextureArrayManager::TEXTURE_LOCATION& location : locations)
+	{
+		location.arrayIndex = -1;
+		location.layer = 0;
+		location.textureID = 0;
+		location.uploadMilliseconds = 0.0f;
+	}
+	// the storage of array textures is fixed once they are
+	// built, so streamed textures are standalone
+	bool bStreaming = m_textureResidency.IsStreaming();
+	bool bUseArrays = (!bStreaming) && (TextureArrayManager::IsSupported());
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	loader.SetCacheEnabled(m_bUseTextureCache);
+	loader.SetCompression(IsTextureCompressionActive());
+	loader.Start(0);
 
-	// if the image was successfully read from the image file
-	if (image)
+	TextureLoader::DECODED_IMAGE image;
+	while (loader.WaitForImage(image))
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		if ((!bUseArrays) && (!bStreaming))
+		{
+			auto uploadStart = std::chrono::high_resolution_clock::now();
+			UploadGLTexture(image, locations[image.requestIndex].textureID, 0);
+			auto uploadEnd = std::chrono::high_resolution_clock::now();
+			locations[image.requestIndex].uploadMilliseconds = std::chrono::duration<float, std::milli>(uploadEnd - uploadStart).count();
+		}
+		images[image.requestIndex] = image;
+	}
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+	if (bUseArrays)
+	{
+		m_textureArrays.Build(images, locations);
 
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// images no array had room for are uploaded on their own
+		for (int i = 0; i < requestCount; i++)
+		{
+			if (locations[i].arrayIndex < 0)
+			{
+				auto uploadStart = std::chrono::high_resolution_clock::now();
+				UploadGLTexture(images[i], locations[i].textureID, 0);
+				auto uploadEnd = std::chrono::high_resolution_clock::now();
+				locations[i].uploadMilliseconds = std::chrono::duration<float, std::milli>(uploadEnd - uploadStart).count();
+			}
+		}
+	}
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+	float totalDecodeMilliseconds = 0.0f;
+	size_t totalTextureBytes = 0;
+	for (int i = 0; i < requestCount; i++)
+	{
+		totalDecodeMilliseconds += images[i].decodeMilliseconds;
+
+		int firstLevel = 0;
+		if (bStreaming)
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			firstLevel = TextureResidencyManager::GetTailLevel(images[i]);
+			auto uploadStart = std::chrono::high_resolution_clock::now();
+			UploadGLTexture(images[i], locations[i].textureID, firstLevel);
+			auto uploadEnd = std::chrono::high_resolution_clock::now();
+			locations[i].uploadMilliseconds = std::chrono::duration<float, std::milli>(uploadEnd - uploadStart).count();
 		}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if (0 != locations[i].textureID)
+		{
+			size_t textureBytes = 0;
+			for (int level = firstLevel; level < (int)images[i].levels.size(); level++)
+			{
+				textureBytes += images[i].levels[level].size;
+			}
+			totalTextureBytes += textureBytes;
+
+			std::cout << "Texture " << images[i].tag << (images[i].bFromCache ? " cache load:" : " decode:")
+				<< images[i].decodeMilliseconds << " ms, upload:" << locations[i].uploadMilliseconds << " ms, "
+				<< (textureBytes / 1024) << " KB";
+			if (locations[i].arrayIndex >= 0)
+			{
+				std::cout << ", array:" << locations[i].arrayIndex << " layer:" << locations[i].layer;
+			}
+			std::cout << std::endl;
+
+			// the residency manager owns the images it streams from
+			if (bStreaming)
+			{
+				m_textureResidency.AddTexture((int)m_textureIDs.size(), images[i]);
+				images[i].pixels = NULL;
+				images[i].pCacheFile = NULL;
+			}
+			RegisterTexture(locations[i].textureID, images[i].tag, locations[i].arrayIndex, locations[i].layer, images[i].channels == 4);
+		}
+		TextureLoader::FreeImage(images[i]);
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	std::cout << "Loaded " << m_textureIDs.size() << " textures in "
+		<< std::chrono::duration<float, std::milli>(loadEnd - loadStart).count()
+		<< " ms, total decode time:" << totalDecodeMilliseconds << " ms, texture memory:"
+		<< (totalTextureBytes / 1024) << " KB, array textures:" << m_textureArrays.GetArrayCount() << std::endl;
+	if (bStreaming)
+	{
+		std::cout << "INFO: Streaming textures within " << (m_textureResidency.GetBudgetBytes() / 1024)
+			<< " KB, the instanced modes sample them only with bindless textures" << std::endl;
+	}
+}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+/***********************************************************
+ *  IsTextureCompressionActive()
+ *
+ *  This method is used for checking whether textures are
+ *  to be block compressed, which needs S3TC support.
+ ***********************************************************/
+bool SceneManager::IsTextureCompressionActive()
+{
+	if (!m_bCompressTextures)
+	{
+		return(false);
+	}
+	if (!GLEW_EXT_texture_compression_s3tc)
+	{
+		std::cout << "INFO: S3TC texture compression is not supported, textures are uncompressed" << std::endl;
+		m_bCompressTextures = false;
+		return(false);
+	}
 
-		return true;
+	return(true);
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for creating an OpenGL texture from
+ *  the mip levels of a decoded image, starting at the passed
+ *  in level.  The levels are prebuilt, so no mipmaps are
+ *  generated on the GPU.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(const TextureLoader::DECODED_IMAGE& image, GLuint& textureID, int firstLevel)
+{
+	textureID = 0;
+
+	// if the image was not successfully read from the image file
+	if ((image.levels.empty()) || (firstLevel < 0) || (firstLevel >= (int)image.levels.size()))
+	{
+		std::cout << "Could not load image:" << image.filename << std::endl;
+		return false;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	GLenum internalFormat = 0;
+	GLenum pixelFormat = 0;
+	// block compressed levels are uploaded as they are stored
+	if (image.format == TextureCache::FORMAT_BC1)
+	{
+		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+	else if (image.format == TextureCache::FORMAT_BC3)
+	{
+		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	// if the loaded image is in RGB format
+	else if (image.channels == 3)
+	{
+		internalFormat = GL_RGB8;
+		pixelFormat = GL_RGB;
+	}
+	// if the loaded image is in RGBA format - it supports transparency
+	else if (image.channels == 4)
+	{
+		internalFormat = GL_RGBA8;
+		pixelFormat = GL_RGBA;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle image with " << image.channels << " channels" << std::endl;
+		return false;
+	}
 
-	// Error loading the image
-	return false;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// the levels are tightly packed, including RGB rows whose
+	// size is not a multiple of four
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	int levelCount = (int)image.levels.size() - firstLevel;
+	for (int level = 0; level < levelCount; level++)
+	{
+		const TextureCache::MIP_LEVEL& mipLevel = image.levels[firstLevel + level];
+		if (image.format != TextureCache::FORMAT_UNCOMPRESSED)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, mipLevel.width, mipLevel.height, 0, (GLsizei)mipLevel.size, mipLevel.pixels);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, internalFormat, mipLevel.width, mipLevel.height, 0, pixelFormat, GL_UNSIGNED_BYTE, mipLevel.pixels);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	return true;
+}
+
+/***********************************************************
+ *  RegisterTexture()
+ *
+ *  This method is used for storing a created texture in the
+ *  next slot and associating it with its tag.
+ ***********************************************************/
+void SceneManager::RegisterTexture(GLuint textureID, const std::string& tag, int arrayIndex, int layer, bool bAlpha)
+{
+	TEXTURE_INFO textureInfo;
+	textureInfo.ID = textureID;
+	textureInfo.tag = tag;
+	textureInfo.arrayIndex = arrayIndex;
+	textureInfo.layer = layer;
+	textureInfo.handle = 0;
+	textureInfo.bAlpha = bAlpha;
+
+	m_textureSlots[tag] = (int)m_textureIDs.size();
+	m_textureIDs.push_back(textureInfo);
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for binding the array textures to
+ *  the units after the draw list texture unit.  The draw
+ *  list binds each object texture as it is drawn, so any
+ *  number of textures can be loaded.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
-	}
+	FrameProfiler::ScopedTimer timer(m_pProfiler, m_textureBindTimer);
+	m_textureArrays.Bind(m_pUniformCache, ARRAY_TEXTURE_UNIT_BASE);
 }
 
 /***********************************************************
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  used texture memory slots, including the array textures
+ *  the slots may be views of and the images kept for
+ *  streaming.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	// bindless handles must not be resident when their
+	// textures are deleted
+	for (TEXTURE_INFO& texture : m_textureIDs)
+	{
+		if (0 != texture.handle)
+		{
+			glMakeTextureHandleNonResidentARB(texture.handle);
+			texture.handle = 0;
+		}
+	}
+	m_bBindlessTexturesActive = false;
+
+	for (int i = 0; i < (int)m_textureIDs.size(); i++)
+	{
+		glDeleteTextures(1, &m_textureIDs[i].ID);
+	}
+	m_textureIDs.clear();
+	m_textureSlots.clear();
+	m_textureArrays.Destroy();
+	m_textureResidency.Clear();
+
+	// deleted texture names may be reused by new textures
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->Invalidate();
+	}
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(const std::string& tag)
+{
+	auto found = m_textureSlots.find(tag);
+	if (found == m_textureSlots.end())
+	{
+		return(-1);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of the previously
+ *  defined material that is associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	auto found = m_materialIndices.find(tag);
+	if (found == m_materialIndices.end())
+	{
+		return(-1);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  ResolveUniforms()
+ *
+ *  This method is used for resolving the handles of every
+ *  uniform that is set while rendering, so the render loop
+ *  never has to look up a uniform location by name.
+ ***********************************************************/
+void SceneManager::ResolveUniforms()
+{
+	if (NULL == m_pUniformCache)
+	{
+		return;
+	}
+
+	m_uniforms.model = m_pUniformCache->GetHandle(g_ModelName);
+	m_uniforms.objectColor = m_pUniformCache->GetHandle(g_ColorValueName);
+	m_uniforms.objectTexture = m_pUniformCache->GetHandle(g_TextureValueName);
+	m_uniforms.useTexture = m_pUniformCache->GetHandle(g_UseTextureName);
+	m_uniforms.useLighting = m_pUniformCache->GetHandle(g_UseLightingName);
+	m_uniforms.UVscale = m_pUniformCache->GetHandle(g_UVScaleName);
+	m_uniforms.materialAmbientColor = m_pUniformCache->GetHandle("material.ambientColor");
+	m_uniforms.materialAmbientStrength = m_pUniformCache->GetHandle("material.ambientStrength");
+	m_uniforms.materialDiffuseColor = m_pUniformCache->GetHandle("material.diffuseColor");
+	m_uniforms.materialSpecularColor = m_pUniformCache->GetHandle("material.specularColor");
+	m_uniforms.materialShininess = m_pUniformCache->GetHandle("material.shininess");
+	m_uniforms.materialIndex = m_pUniformCache->GetHandle(g_MaterialIndexName);
+	m_uniforms.textureIndex = m_pUniformCache->GetHandle(g_TextureIndexName);
+	m_uniforms.useBindlessTextures = m_pUniformCache->GetHandle(g_UseBindlessName);
+}
+
+/***********************************************************
+ *  CreateMaterialBuffer()
+ *
+ *  This method is used for uploading every defined material
+ *  into a std140 uniform buffer once.  When the shader
+ *  declares the material block, draws select a material by
+ *  setting a single index; otherwise the material values are
+ *  still passed as separate uniforms.  The buffer is sized
+ *  for the whole block, so the bindless texture handles can
+ *  be stored after the materials once the textures exist.
+ ***********************************************************/
+void SceneManager::CreateMaterialBuffer()
+{
+	if ((NULL == m_pUniformCache) || (m_objectMaterials.size() == 0))
+	{
+		return;
+	}
+
+	if (m_objectMaterials.size() > MAX_BLOCK_MATERIALS)
+	{
+		std::cout << "Material block holds " << MAX_BLOCK_MATERIALS << " materials, "
+			<< m_objectMaterials.size() << " defined" << std::endl;
+		return;
+	}
+
+	std::vector<MATERIAL_BLOCK_ENTRY> entries(m_objectMaterials.size());
+	for (int i = 0; i < (int)m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		entries[i].ambient = glm::vec4(material.ambientColor, material.ambientStrength);
+		entries[i].diffuse = glm::vec4(material.diffuseColor, 0.0f);
+		entries[i].specular = glm::vec4(material.specularColor, material.shininess);
+	}
+
+	if (0 == m_materialBuffer)
+	{
+		glGenBuffers(1, &m_materialBuffer);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_SIZE, NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, entries.size() * sizeof(MATERIAL_BLOCK_ENTRY), entries.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, m_materialBuffer);
+
+	// only select materials by index when the shader reads the block
+	m_bMaterialBufferActive = BindMaterialBlock(m_pUniformCache->GetProgramID());
+}
+
+/***********************************************************
+ *  CreateBindlessTextures()
+ *
+ *  This method is used for making every loaded texture
+ *  resident and storing its bindless handle in the material
+ *  buffer, so draws select a texture by index instead of
+ *  binding it.  The slot path stays in use when bindless
+ *  textures were not requested, the driver does not support
+ *  them, or the handles do not fit in the material block.
+ ***********************************************************/
+void SceneManager::CreateBindlessTextures()
+{
+	if (!m_bBindlessTextures)
+	{
+		return;
+	}
+	if (!GLEW_ARB_bindless_texture)
+	{
+		std::cout << "INFO: Bindless textures are not supported, textures are bound to slots" << std::endl;
+		m_bBindlessTextures = false;
+		return;
+	}
+	if ((0 == m_materialBuffer) || (m_textureIDs.size() > MAX_BLOCK_TEXTURES))
+	{
+		std::cout << "INFO: Material block holds " << MAX_BLOCK_TEXTURES << " texture handles, "
+			<< m_textureIDs.size() << " textures loaded, textures are bound to slots" << std::endl;
+		m_bBindlessTextures = false;
+		return;
+	}
+
+	for (int i = 0; i < (int)m_textureIDs.size(); i++)
+	{
+		StoreBindlessHandle(i);
+	}
+
+	m_bBindlessTexturesActive = true;
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->SetBoolValue(m_uniforms.useBindlessTextures, true);
+	}
+
+	std::cout << "INFO: Bindless textures active, " << m_textureIDs.size() << " handles resident" << std::endl;
+	if (!IsShaderTextureIndexed())
+	{
+		std::cout << "INFO: Scene shader does not read texture handles, the draw list binds textures to slots" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  IsShaderTextureIndexed()
+ *
+ *  This method is used for checking whether the scene
+ *  shader can select textures by slot.  It needs both the
+ *  material block holding the handles and an active texture
+ *  index uniform; a shader that declares the block but not
+ *  the index keeps textures bound to the draw list unit.
+ ***********************************************************/
+bool SceneManager::IsShaderTextureIndexed() const
+{
+	return((m_bMaterialBufferActive) &&
+		(NULL != m_pUniformCache) &&
+		(UniformCache::INVALID_HANDLE != m_uniforms.textureIndex));
+}
+
+/***********************************************************
+ *  StoreBindlessHandle()
+ *
+ *  This method is used for making the texture in the passed
+ *  in slot resident and storing its handle in the material
+ *  buffer.  The handle of a texture it replaces is made
+ *  non-resident first.
+ ***********************************************************/
+void SceneManager::StoreBindlessHandle(int textureSlot)
+{
+	TEXTURE_INFO& texture = m_textureIDs[textureSlot];
+	if (0 != texture.handle)
+	{
+		glMakeTextureHandleNonResidentARB(texture.handle);
+	}
+
+	// the sampler state of a texture is frozen once it has a
+	// handle, it is all set when the texture is created
+	texture.handle = glGetTextureHandleARB(texture.ID);
+	glMakeTextureHandleResidentARB(texture.handle);
+
+	GLuint handleWords[BLOCK_HANDLE_WORDS] = { 0, 0, 0, 0 };
+	handleWords[0] = (GLuint)(texture.handle & 0xFFFFFFFF);
+	handleWords[1] = (GLuint)(texture.handle >> 32);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+	glBufferSubData(
+		GL_UNIFORM_BUFFER,
+		BLOCK_HANDLES_OFFSET + (textureSlot * sizeof(handleWords)),
+		sizeof(handleWords),
+		handleWords);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BindMaterialBlock()
+ *
+ *  This method is used for connecting the material block of
+ *  a shader program to the material uniform buffer.  Returns
+ *  false when the program does not declare the block, or
+ *  declares a larger block than the buffer holds, since the
+ *  shader would read past the end of the bound buffer.
+ ***********************************************************/
+bool SceneManager::BindMaterialBlock(GLuint programID)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(programID, g_MaterialBlockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
+
+	GLint blockSize = 0;
+	glGetActiveUniformBlockiv(programID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+	if ((size_t)blockSize > MATERIAL_BLOCK_SIZE)
+	{
+		std::cout << "Material block of the shader needs " << blockSize << " bytes, the buffer holds "
+			<< MATERIAL_BLOCK_SIZE << std::endl;
+		return(false);
+	}
+
+	glUniformBlockBinding(programID, blockIndex, MATERIAL_BLOCK_BINDING);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetModelMatrix()
+ *
+ *  This method is used for setting a precomposed model
+ *  matrix into the shader for the next draw command.
+ ***********************************************************/
+void SceneManager::SetModelMatrix(const glm::mat4& modelMatrix)
+{
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->SetMat4Value(m_uniforms.model, modelMatrix);
+	}
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for recomposing the cached model
+ *  matrix of every scene object whose transform changed
+ *  since the last frame.  Static objects are composed once
+ *  after loading and skipped from then on.
+ ***********************************************************/
+void SceneManager::UpdateTransforms()
+{
+	// the dirty matrices are composed four at a time by the
+	// transform store, one chunk of the objects per task
+	int objectCount = m_transforms.GetCount();
+	int chunkCount = (objectCount + TRANSFORM_CHUNK_SIZE - 1) / TRANSFORM_CHUNK_SIZE;
+	PrepareChunkResults(chunkCount);
+
+	ParallelFor(objectCount, TRANSFORM_CHUNK_SIZE, [this](int begin, int end)
+	{
+		std::vector<int>& rebuilt = m_chunkResults[begin / TRANSFORM_CHUNK_SIZE];
+		m_transforms.ComposeDirtyRange(begin, end - begin, rebuilt);
+
+		for (int i : rebuilt)
+		{
+			SCENE_OBJECT& object = m_sceneObjects[i];
+			object.worldBounds = SceneBVH::TransformBox(GetMeshBounds(object.meshType), m_transforms.GetMatrix(i));
+		}
+	});
+
+	MergeChunkResults(chunkCount, m_rebuiltTransforms);
+	m_frameStats.rebuiltMatrices = (int)m_rebuiltTransforms.size();
+
+	// moved objects invalidate the culling hierarchy
+	if (m_frameStats.rebuiltMatrices > 0)
+	{
+		m_bBVHDirty = true;
+	}
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the object space bounds
+ *  of a basic shape.  The bounds are taken from the vertices
+ *  the shape buffer captured from the ShapeMeshes shapes, so
+ *  every render mode culls with the geometry it draws.
+ ***********************************************************/
+SceneBVH::BOUNDING_BOX SceneManager::GetMeshBounds(int meshType) const
+{
+	const ShapeBuffer::MESH_RANGE& range = m_shapeBuffer.GetMeshRange(meshType);
+	SceneBVH::BOUNDING_BOX bounds;
+	bounds.boundsMin = range.boundsMin;
+	bounds.boundsMax = range.boundsMax;
+
+	return(bounds);
+}
+
+/***********************************************************
+ *  CullScene()
+ *
+ *  This method is used for collecting the objects whose
+ *  bounds are inside the view frustum of the current frame.
+ *  The hierarchy over the object bounds is only rebuilt
+ *  after objects have moved.
+ ***********************************************************/
+void SceneManager::CullScene()
+{
+	m_visibleObjects.clear();
+
+	if (!m_bFrustumCulling)
+	{
+		for (int i = 0; i < (int)m_sceneObjects.size(); i++)
+		{
+			m_visibleObjects.push_back(i);
+		}
+	}
+	else
+	{
+		if ((m_bBVHDirty) || (m_sceneBVH.GetObjectCount() != (int)m_sceneObjects.size()))
+		{
+			std::vector<SceneBVH::BOUNDING_BOX> objectBoxes(m_sceneObjects.size());
+			for (int i = 0; i < (int)m_sceneObjects.size(); i++)
+			{
+				objectBoxes[i] = m_sceneObjects[i].worldBounds;
+			}
+			m_sceneBVH.Build(objectBoxes);
+			m_bBVHDirty = false;
+		}
+
+		// the subtrees of the hierarchy are culled in parallel,
+		// and their results appended in depth first order.  A
+		// single subtree, the root, is culled inline
+		int threadCount = (NULL != m_pThreadPool) ? m_pThreadPool->GetWorkerCount() + 1 : 1;
+		int subtreeTarget = std::min(threadCount * CULL_SUBTREES_PER_THREAD,
+			(int)m_sceneObjects.size() / CULL_OBJECTS_PER_SUBTREE);
+		m_sceneBVH.GetSubtrees(std::max(subtreeTarget, 1), m_cullSubtrees);
+		int subtreeCount = (int)m_cullSubtrees.size();
+		PrepareChunkResults(subtreeCount);
+
+		SceneBVH::FRUSTUM frustum = SceneBVH::ExtractFrustum(m_projectionMatrix * m_viewMatrix);
+		ParallelFor(subtreeCount, 1, [this, &frustum](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				m_sceneBVH.CollectSubtree(m_cullSubtrees[i], frustum, m_chunkResults[i]);
+			}
+		});
+
+		MergeChunkResults(subtreeCount, m_visibleObjects);
+
+		// an unsorted draw list is submitted in scene table order,
+		// not in the order the hierarchy was walked
+		if (!m_bSortDrawList)
+		{
+			std::sort(m_visibleObjects.begin(), m_visibleObjects.end());
+		}
+	}
+
+	m_frameStats.visibleObjects = (int)m_visibleObjects.size();
+	m_frameStats.culledObjects = (int)m_sceneObjects.size() - (int)m_visibleObjects.size();
+}
+
+/***********************************************************
+ *  RequestTextureLevels()
+ *
+ *  This method is used for asking the residency manager for
+ *  the mip level each visible texture needs, from the size
+ *  of the objects using it on screen.  It runs in the
+ *  update phase and issues no GL calls.
+ ***********************************************************/
+void SceneManager::RequestTextureLevels()
+{
+	m_textureResidency.BeginFrame();
+
+	// an orthographic projection has no perspective divide,
+	// so the screen size of an object does not depend on its
+	// distance from the camera
+	bool bOrthographic = (m_projectionMatrix[2][3] == 0.0f) && (m_projectionMatrix[3][3] == 1.0f);
+
+	// screen pixels covered by one unit, at a distance of one
+	// for a perspective projection
+	float pixelsPerUnit = m_projectionMatrix[1][1] * 0.5f * (float)m_viewportHeight;
+	for (int i : m_visibleObjects)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		if (object.textureSlot < 0)
+		{
+			continue;
+		}
+
+		glm::vec3 center = (object.worldBounds.boundsMin + object.worldBounds.boundsMax) * 0.5f;
+		float radius = glm::length(object.worldBounds.boundsMax - object.worldBounds.boundsMin) * 0.5f;
+		float distance = glm::length(center - m_viewPosition);
+
+		// the finest level is needed when the camera is inside
+		// the bounds of the object
+		int level = 0;
+		if ((bOrthographic) || (distance > radius))
+		{
+			float screenPixels = 2.0f * radius * pixelsPerUnit;
+			if (!bOrthographic)
+			{
+				screenPixels /= distance;
+			}
+			float repeatCount = std::max(object.UVscale.x, object.UVscale.y);
+			level = m_textureResidency.GetLevelForCoverage(object.textureSlot, repeatCount, screenPixels);
+		}
+		m_textureResidency.RequestLevel(object.textureSlot, level);
+	}
+}
+
+/***********************************************************
+ *  UpdateTextureResidency()
+ *
+ *  This method is used for applying the residency changes
+ *  chosen for this frame.  Each changed texture is created
+ *  again with its new finest level as level 0, replacing
+ *  the old texture in its slot, so the memory of trimmed
+ *  levels is freed instead of only going unused.
+ ***********************************************************/
+void SceneManager::UpdateTextureResidency()
+{
+	m_textureResidency.Update(m_residencyChanges);
+	for (const TextureResidencyManager::RESIDENCY_CHANGE& change : m_residencyChanges)
+	{
+		GLuint textureID = 0;
+		if (!UploadGLTexture(m_textureResidency.GetImage(change.textureSlot), textureID, change.firstLevel))
+		{
+			continue;
+		}
+
+		TEXTURE_INFO& texture = m_textureIDs[change.textureSlot];
+		GLuint replacedID = texture.ID;
+		texture.ID = textureID;
+		if (m_bBindlessTexturesActive)
+		{
+			StoreBindlessHandle(change.textureSlot);
+		}
+		glDeleteTextures(1, &replacedID);
+	}
+
+	// deleted texture names may be reused by new textures
+	if ((!m_residencyChanges.empty()) && (NULL != m_pUniformCache))
+	{
+		m_pUniformCache->Invalidate();
+	}
+
+	m_frameStats.textureResidentBytes = m_textureResidency.GetResidentBytes();
+	m_frameStats.texturesStreamed = m_textureResidency.GetStreamedCount();
+	m_frameStats.texturesEvicted = m_textureResidency.GetEvictedCount();
+}
+
+/***********************************************************
+ *  IsObjectTranslucent()
+ *
+ *  This method is used for checking whether a scene object
+ *  has to be blended against what is drawn behind it.  A
+ *  textured object is translucent when its texture has an
+ *  alpha channel, and an untextured one when the alpha of
+ *  its color is below one.
+ ***********************************************************/
+bool SceneManager::IsObjectTranslucent(const SCENE_OBJECT& object) const
+{
+	if ((object.textureSlot >= 0) && (object.textureSlot < (int)m_textureIDs.size()))
+	{
+		return(m_textureIDs[object.textureSlot].bAlpha);
+	}
+
+	return(object.color.a < 1.0f);
+}
+
+/***********************************************************
+ *  SplitTranslucentObjects()
+ *
+ *  This method is used for splitting the visible objects of
+ *  the instanced modes.  Instances are drawn grouped by
+ *  mesh in no particular depth order, so only the opaque
+ *  objects are instanced and the translucent ones are drawn
+ *  through the sorted draw list after them.
+ ***********************************************************/
+void SceneManager::SplitTranslucentObjects()
+{
+	m_instancedObjects.clear();
+	m_translucentObjects.clear();
+	for (int i : m_visibleObjects)
+	{
+		if (m_sceneObjects[i].bTranslucent)
+		{
+			m_translucentObjects.push_back(i);
+		}
+		else
+		{
+			m_instancedObjects.push_back(i);
+		}
 	}
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  BuildDrawList()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for recording a draw command with a
+ *  render state sort key for every passed in object, and
+ *  sorting the commands so opaque draws sharing a texture
+ *  and material are submitted together, followed by the
+ *  translucent draws back to front.  The keys are made in
+ *  parallel, each task writing its own range of commands.
+ *  The translucent draws of the instanced modes are always
+ *  sorted, since only the draw list mode can be unsorted.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::BuildDrawList(const std::vector<int>& objects)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	m_drawList.Resize((int)objects.size());
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	ParallelFor((int)objects.size(), SORT_KEY_CHUNK_SIZE, [this, &objects](int begin, int end)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		for (int command = begin; command < end; command++)
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			int i = objects[command];
+			const SCENE_OBJECT& object = m_sceneObjects[i];
+			float viewDepth = glm::length(m_transforms.GetPosition(i) - m_viewPosition);
+
+			m_drawList.SetCommand(
+				command,
+				DrawList::MakeSortKey(object.bTranslucent, 0, object.textureSlot, object.materialIndex, object.meshType, viewDepth),
+				i);
 		}
-		else
-			index++;
-	}
+	});
 
-	return(textureID);
+	if ((m_bSortDrawList) || (m_renderMode != RENDER_DRAW_LIST))
+	{
+		m_drawList.Sort();
+	}
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  ParallelFor()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for running a loop of the update
+ *  phase on the thread pool, or on the calling thread when
+ *  no pool is set.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+void SceneManager::ParallelFor(int count, int grainSize, const ThreadPool::RANGE_FUNCTION& body)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	if (NULL != m_pThreadPool)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		m_pThreadPool->ParallelFor(count, grainSize, body);
+	}
+	else if (count > 0)
+	{
+		body(0, count);
 	}
-
-	return(textureSlot);
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  PrepareChunkResults()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for emptying the per-chunk result
+ *  lists before a parallel loop fills them.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::PrepareChunkResults(int chunkCount)
 {
-	if (m_objectMaterials.size() == 0)
+	if ((int)m_chunkResults.size() < chunkCount)
 	{
-		return(false);
+		m_chunkResults.resize(chunkCount);
+	}
+	for (int i = 0; i < chunkCount; i++)
+	{
+		m_chunkResults[i].clear();
 	}
+}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+/***********************************************************
+ *  MergeChunkResults()
+ *
+ *  This method is used for appending the per-chunk results
+ *  of a parallel loop in chunk order, so the merged list
+ *  matches the serial order.
+ ***********************************************************/
+void SceneManager::MergeChunkResults(int chunkCount, std::vector<int>& results)
+{
+	size_t totalCount = 0;
+	for (int i = 0; i < chunkCount; i++)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
+		totalCount += m_chunkResults[i].size();
 	}
 
-	return(true);
+	results.clear();
+	results.reserve(totalCount);
+	for (int i = 0; i < chunkCount; i++)
+	{
+		results.insert(results.end(), m_chunkResults[i].begin(), m_chunkResults[i].end());
+	}
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  SetObjectTransform()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for moving a scene object.  The
+ *  object is marked dirty so its model matrix is rebuilt
+ *  at the start of the next rendered frame.
  ***********************************************************/
-void SceneManager::SetTransformations(
+void SceneManager::SetObjectTransform(
+	int objectIndex,
 	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
+	glm::vec3 rotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
+	if ((objectIndex < 0) || (objectIndex >= (int)m_sceneObjects.size()))
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		return;
 	}
+
+	m_transforms.Set(objectIndex, scaleXYZ, rotationDegrees, positionXYZ);
+	m_bSceneChanged = true;
 }
 
 /***********************************************************
@@ -298,30 +1084,74 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
+	if (NULL != m_pUniformCache)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_pUniformCache->SetBoolValue(m_uniforms.useTexture, false);
+		m_pUniformCache->SetVec4Value(m_uniforms.objectColor, currentColor);
 	}
 }
 
 /***********************************************************
  *  SetShaderTexture()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for setting the texture in the
+ *  passed in slot into the shader.  The slot is resolved
+ *  from the texture tag when the scene is loaded.  In
+ *  bindless mode the shader reads the handle of the slot
+ *  from the material buffer; otherwise its texture is bound
+ *  to the draw list texture unit.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	int textureSlot)
 {
-	if (NULL != m_pShaderManager)
+	if ((NULL == m_pUniformCache) ||
+		(textureSlot < 0) ||
+		(textureSlot >= (int)m_textureIDs.size()))
+	{
+		return;
+	}
+
+	FrameProfiler::ScopedTimer timer(m_pProfiler, m_textureBindTimer);
+	if ((m_bBindlessTexturesActive) && (IsShaderTextureIndexed()))
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_pUniformCache->SetBoolValue(m_uniforms.useTexture, true);
+		m_pUniformCache->SetIntValue(m_uniforms.textureIndex, textureSlot);
+	}
+	else
+	{
+		m_pUniformCache->BindTexture(LEGACY_TEXTURE_UNIT, GL_TEXTURE_2D, m_textureIDs[textureSlot].ID);
+		m_pUniformCache->SetBoolValue(m_uniforms.useTexture, true);
+		m_pUniformCache->SetSampler2DValue(m_uniforms.objectTexture, LEGACY_TEXTURE_UNIT);
+	}
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+/***********************************************************
+ *  GetInstanceTextureParam()
+ *
+ *  This method is used for getting the instance parameter
+ *  the instanced shader selects the texture in the passed
+ *  in slot with.  In bindless mode it is one more than the
+ *  slot, whose handle is read from the material buffer.
+ *  Otherwise it is one more than the packed array texture
+ *  and layer.  It is 0 when the object is untextured.
+ ***********************************************************/
+int SceneManager::GetInstanceTextureParam(int textureSlot)
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_textureIDs.size()))
+	{
+		return(0);
+	}
+	if (m_bBindlessTexturesActive)
+	{
+		return(textureSlot + 1);
+	}
+	if (m_textureIDs[textureSlot].arrayIndex < 0)
+	{
+		return(0);
 	}
+
+	const TEXTURE_INFO& texture = m_textureIDs[textureSlot];
+	return((texture.arrayIndex * TextureArrayManager::MAX_ARRAY_LAYERS) + texture.layer + 1);
 }
 
 /***********************************************************
@@ -332,36 +1162,42 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
+	if (NULL != m_pUniformCache)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_pUniformCache->SetVec2Value(m_uniforms.UVscale, glm::vec2(u, v));
 	}
 }
 
 /***********************************************************
  *  SetShaderMaterial()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for passing the values of the
+ *  material at the passed in index into the shader.  The
+ *  index is resolved from the material tag when the scene
+ *  is loaded.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	int materialIndex)
 {
-	if (m_objectMaterials.size() > 0)
+	if ((materialIndex < 0) || (materialIndex >= (int)m_objectMaterials.size()) ||
+		(NULL == m_pUniformCache))
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		return;
+	}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+	// the material values already live in the uniform buffer
+	if (m_bMaterialBufferActive)
+	{
+		m_pUniformCache->SetIntValue(m_uniforms.materialIndex, materialIndex);
+		return;
 	}
+
+	const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+	m_pUniformCache->SetVec3Value(m_uniforms.materialAmbientColor, material.ambientColor);
+	m_pUniformCache->SetFloatValue(m_uniforms.materialAmbientStrength, material.ambientStrength);
+	m_pUniformCache->SetVec3Value(m_uniforms.materialDiffuseColor, material.diffuseColor);
+	m_pUniformCache->SetVec3Value(m_uniforms.materialSpecularColor, material.specularColor);
+	m_pUniformCache->SetFloatValue(m_uniforms.materialShininess, material.shininess);
 }
 
 /**************************************************************/
@@ -379,11 +1215,15 @@ void SceneManager::SetShaderMaterial(
  ***********************************************************/
 void SceneManager::CreateSceneTextures()
 {
-	CreateGLTexture("textures/wood.jpg", "WoodFloor");
-	CreateGLTexture("textures/aluminum.jpg", "Aluminum");
-	CreateGLTexture("textures/egyptian-bricks.jpg", "Pyramid");
-	CreateGLTexture("textures/orange.jpg", "Orange");
-	CreateGLTexture("textures/dirt.jpg", "Dirt");
+	// the image files are decoded in parallel and uploaded
+	// as each decode finishes
+	TextureLoader loader;
+	loader.AddRequest("textures/wood.jpg", "WoodFloor");
+	loader.AddRequest("textures/aluminum.jpg", "Aluminum");
+	loader.AddRequest("textures/egyptian-bricks.jpg", "Pyramid");
+	loader.AddRequest("textures/orange.jpg", "Orange");
+	loader.AddRequest("textures/dirt.jpg", "Dirt");
+	CreateGLTextures(loader);
 
 	BindGLTextures();
 
@@ -393,42 +1233,43 @@ void SceneManager::CreateSceneTextures()
  *
  *  This method is called to add and configure the light
  *  sources for the 3D scene.  There are up to 4 light sources.
+ *  The passed in shader program must be the active one.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::SetupSceneLights(ShaderManager* pShaderManager)
 {
 	// back left light (doesnt show up for some reason)
-	m_pShaderManager->setVec3Value("lightSources[0].position", -50.0f, 20.0, -60.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.07f, 0.07f, 0.07f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 100.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.05f);
+	pShaderManager->setVec3Value("lightSources[0].position", -50.0f, 20.0, -60.0f);
+	pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.07f, 0.07f, 0.07f);
+	pShaderManager->setVec3Value("lightSources[0].diffuseColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setVec3Value("lightSources[0].specularColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setFloatValue("lightSources[0].focalStrength", 100.0f);
+	pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.05f);
 
 	// back right light
-	m_pShaderManager->setVec3Value("lightSources[1].position", 50.0f, 20.0f, -60.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.07f, 0.07f, 0.07f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 100.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.05f);
+	pShaderManager->setVec3Value("lightSources[1].position", 50.0f, 20.0f, -60.0f);
+	pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.07f, 0.07f, 0.07f);
+	pShaderManager->setVec3Value("lightSources[1].diffuseColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setVec3Value("lightSources[1].specularColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setFloatValue("lightSources[1].focalStrength", 100.0f);
+	pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.05f);
 
 	// front left light (middle left yellow light)
-	m_pShaderManager->setVec3Value("lightSources[2].position", -50.0f, 20.0f, -10.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.07f, 0.07f, 0.07f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 100.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.05f);
+	pShaderManager->setVec3Value("lightSources[2].position", -50.0f, 20.0f, -10.0f);
+	pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.07f, 0.07f, 0.07f);
+	pShaderManager->setVec3Value("lightSources[2].diffuseColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setVec3Value("lightSources[2].specularColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setFloatValue("lightSources[2].focalStrength", 100.0f);
+	pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.05f);
 
 	// front right light
-	m_pShaderManager->setVec3Value("lightSources[3].position", 40.0f, 20.0f, -10.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.07f, 0.07f, 0.07f);
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 100.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.18f);
-
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	pShaderManager->setVec3Value("lightSources[3].position", 40.0f, 20.0f, -10.0f);
+	pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.07f, 0.07f, 0.07f);
+	pShaderManager->setVec3Value("lightSources[3].diffuseColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setVec3Value("lightSources[3].specularColor", 1.0f, 1.0f, 1.0f);
+	pShaderManager->setFloatValue("lightSources[3].focalStrength", 100.0f);
+	pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.18f);
+
+	pShaderManager->setBoolValue(g_UseLightingName, true);
 }
 
 /***********************************************************
@@ -502,6 +1343,17 @@ void SceneManager::DefineObjectMaterials()
 	cylinderMaterial.shininess = 75;
 	cylinderMaterial.tag = "cylinder";
 	m_objectMaterials.push_back(cylinderMaterial);
+
+	// index the materials by tag so scene objects can resolve
+	// their material handle once at load time
+	m_materialIndices.clear();
+	for (int i = 0; i < (int)m_objectMaterials.size(); i++)
+	{
+		m_materialIndices[m_objectMaterials[i].tag] = i;
+	}
+
+	// upload all of the materials to the GPU once
+	CreateMaterialBuffer();
 }
 
 /***********************************************************
@@ -509,18 +1361,23 @@ void SceneManager::DefineObjectMaterials()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  Returns false when the scene file could not
+ *  be loaded.
  ***********************************************************/
-void SceneManager::PrepareScene()
+bool SceneManager::PrepareScene(const char* sceneFilename)
 {
 	
 	// define the materials for objects in the scene
 	DefineObjectMaterials();
 	// add and define the light sources for the scene
-	SetupSceneLights();
+	SetupSceneLights(m_pShaderManager);
 	// making the textures for the scene
+	TraceRecorder::BeginEvent("CreateSceneTextures");
 	CreateSceneTextures();
+	CreateBindlessTextures();
+	TraceRecorder::EndEvent("CreateSceneTextures");
 	// loading in the meshes
+	TraceRecorder::BeginEvent("LoadMeshes");
 	m_basicMeshes->LoadPlaneMesh();
 	m_basicMeshes->LoadTaperedCylinderMesh();
 	m_basicMeshes->LoadTorusMesh();
@@ -529,369 +1386,590 @@ void SceneManager::PrepareScene()
 	m_basicMeshes->LoadPrismMesh();
 	m_basicMeshes->LoadSphereMesh();
 	m_basicMeshes->LoadPyramid4Mesh();
+	// the instanced modes and the culling bounds use the same
+	// triangles, recorded from the meshes just loaded
+	if (!m_shapeBuffer.Create([this](int meshType) { DrawMesh((MESH_TYPE)meshType); }))
+	{
+		std::cout << "Could not capture the basic shape meshes" << std::endl;
+		TraceRecorder::EndEvent("LoadMeshes");
+		return(false);
+	}
+	TraceRecorder::EndEvent("LoadMeshes");
+	// loading in the objects that make up the scene
+	TraceRecorder::BeginEvent("LoadSceneFile");
+	bool bLoaded = LoadSceneFile(sceneFilename);
+	TraceRecorder::EndEvent("LoadSceneFile");
+
+	return(bLoaded);
+}
+
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This method is used for reading the scene object table
+ *  from a text file.  Each non-comment line describes one
+ *  object:
+ *
+ *    <mesh> <scale xyz> <rotation xyz> <position xyz> <material>
+ *        texture <tag> <u> <v>
+ *    <mesh> <scale xyz> <rotation xyz> <position xyz> <material>
+ *        color <r> <g> <b> <a>
+ *
+ *  Lines that cannot be parsed are reported and skipped.
+ *  Returns false when the file cannot be read or holds no
+ *  valid objects at all.
+ ***********************************************************/
+bool SceneManager::LoadSceneFile(const char* filename)
+{
+	std::ifstream sceneFile(filename);
+	if (!sceneFile.is_open())
+	{
+		std::cout << "Could not load scene file:" << filename << std::endl;
+		return false;
+	}
+
+	m_sceneObjects.clear();
+	m_transforms.Clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(sceneFile, line))
+	{
+		lineNumber++;
+
+		// skip blank lines and comments
+		size_t firstChar = line.find_first_not_of(" \t\r");
+		if ((firstChar == std::string::npos) || (line[firstChar] == '#'))
+		{
+			continue;
+		}
+
+		std::istringstream fields(line);
+		std::string meshName;
+		std::string surface;
+		SCENE_OBJECT object;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+
+		fields >> meshName
+			>> scaleXYZ.x >> scaleXYZ.y >> scaleXYZ.z
+			>> rotationDegrees.x >> rotationDegrees.y >> rotationDegrees.z
+			>> positionXYZ.x >> positionXYZ.y >> positionXYZ.z
+			>> object.materialTag >> surface;
+
+		object.UVscale = glm::vec2(1.0f, 1.0f);
+		object.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		if (surface == "texture")
+		{
+			fields >> object.textureTag >> object.UVscale.x >> object.UVscale.y;
+		}
+		else if (surface == "color")
+		{
+			fields >> object.color.r >> object.color.g >> object.color.b >> object.color.a;
+		}
+		else
+		{
+			fields.setstate(std::ios::failbit);
+		}
+
+		bool bKnownMesh = true;
+		if (meshName == "plane") object.meshType = MESH_PLANE;
+		else if (meshName == "box") object.meshType = MESH_BOX;
+		else if (meshName == "cylinder") object.meshType = MESH_CYLINDER;
+		else if (meshName == "taperedcylinder") object.meshType = MESH_TAPERED_CYLINDER;
+		else if (meshName == "torus") object.meshType = MESH_TORUS;
+		else if (meshName == "prism") object.meshType = MESH_PRISM;
+		else if (meshName == "sphere") object.meshType = MESH_SPHERE;
+		else if (meshName == "pyramid4") object.meshType = MESH_PYRAMID4;
+		else bKnownMesh = false;
+
+		if ((fields.fail()) || (bKnownMesh == false))
+		{
+			std::cout << "Skipping invalid scene object at " << filename << ":" << lineNumber << std::endl;
+			continue;
+		}
+
+		// resolve the tags into handles so the render path
+		// never has to search by string.  An unknown material
+		// falls back to the first defined material, so every
+		// render mode draws the object the same way
+		object.materialIndex = FindMaterialIndex(object.materialTag);
+		if (object.materialIndex < 0)
+		{
+			std::cout << "Unknown material " << object.materialTag << " at " << filename << ":" << lineNumber;
+			if (m_objectMaterials.size() > 0)
+			{
+				object.materialIndex = 0;
+				object.materialTag = m_objectMaterials[0].tag;
+				std::cout << ", using " << object.materialTag;
+			}
+			std::cout << std::endl;
+		}
+		object.textureSlot = -1;
+		if (!object.textureTag.empty())
+		{
+			object.textureSlot = FindTextureSlot(object.textureTag);
+			if (object.textureSlot < 0)
+			{
+				std::cout << "Unknown texture " << object.textureTag << " at " << filename << ":" << lineNumber << std::endl;
+			}
+		}
+		object.bTranslucent = IsObjectTranslucent(object);
+
+		m_sceneObjects.push_back(object);
+		m_transforms.Add(scaleXYZ, rotationDegrees, positionXYZ);
+	}
+
+	if (sceneFile.bad())
+	{
+		std::cout << "Could not read scene file:" << filename << std::endl;
+		return false;
+	}
+	if (m_sceneObjects.empty())
+	{
+		std::cout << "Scene file has no valid objects:" << filename << std::endl;
+		return false;
+	}
+
+	std::cout << "Successfully loaded scene:" << filename << ", objects:" << m_sceneObjects.size() << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the basic shape mesh
+ *  that matches the passed in mesh type.
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE meshType)
+{
+	switch (meshType)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_TAPERED_CYLINDER:
+		m_basicMeshes->DrawTaperedCylinderMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	case MESH_PRISM:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_PYRAMID4:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  GenerateScene()
+ *
+ *  This method is used for replacing the scene table with
+ *  randomly placed objects that use the defined materials
+ *  and loaded textures.  The same seed always generates
+ *  the same scene, which makes it useful for benchmarking.
+ ***********************************************************/
+void SceneManager::GenerateScene(int objectCount, unsigned int seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> positionX(-9.0f, 9.0f);
+	std::uniform_real_distribution<float> positionZ(-19.0f, 19.0f);
+	std::uniform_real_distribution<float> size(0.1f, 0.5f);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_int_distribution<int> mesh(MESH_BOX, MESH_TYPE_COUNT - 1);
+
+	m_sceneObjects.clear();
+	m_sceneObjects.reserve(objectCount);
+	m_transforms.Clear();
+	m_transforms.Reserve(objectCount);
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		SCENE_OBJECT object;
+		float objectSize = size(generator);
+
+		object.meshType = (MESH_TYPE)mesh(generator);
+		float rotationY = angle(generator);
+		float objectX = positionX(generator);
+		float objectZ = positionZ(generator);
+		m_transforms.Add(
+			glm::vec3(objectSize, objectSize, objectSize),
+			glm::vec3(0.0f, rotationY, 0.0f),
+			glm::vec3(objectX, objectSize, objectZ));
+		object.UVscale = glm::vec2(1.0f, 1.0f);
+		object.color = glm::vec4(unit(generator), unit(generator), unit(generator), 1.0f);
+
+		object.materialIndex = -1;
+		if (m_objectMaterials.size() > 0)
+		{
+			object.materialIndex = (int)(generator() % m_objectMaterials.size());
+			object.materialTag = m_objectMaterials[object.materialIndex].tag;
+		}
+
+		// roughly half of the objects are textured
+		object.textureSlot = -1;
+		if ((!m_textureIDs.empty()) && (unit(generator) < 0.5f))
+		{
+			object.textureSlot = (int)(generator() % m_textureIDs.size());
+			object.textureTag = m_textureIDs[object.textureSlot].tag;
+		}
+		object.bTranslucent = IsObjectTranslucent(object);
+
+		m_sceneObjects.push_back(object);
+	}
+
+	std::cout << "Generated scene with " << objectCount << " objects, seed:" << seed << std::endl;
+}
+
+/***********************************************************
+ *  DrawSceneObject()
+ *
+ *  This method is used for setting the transform, texture
+ *  or color, and material of a scene object into the shader
+ *  and drawing its mesh.
+ ***********************************************************/
+void SceneManager::DrawSceneObject(int objectIndex)
+{
+	const SCENE_OBJECT& object = m_sceneObjects[objectIndex];
+	SetModelMatrix(m_transforms.GetMatrix(objectIndex));
+
+	// objects without a texture are drawn with a solid color
+	if (object.textureSlot < 0)
+	{
+		SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+	}
+	else
+	{
+		SetShaderTexture(object.textureSlot);
+		SetTextureUVScale(object.UVscale.x, object.UVscale.y);
+	}
+	SetShaderMaterial(object.materialIndex);
+
+	DrawMesh(object.meshType);
+	m_frameStats.drawCalls++;
+}
+
+/***********************************************************
+ *  SetProfiler()
+ *
+ *  This method is used for adding the timers of the texture
+ *  residency update, each render mode and texture binding
+ *  to the passed in profiler.  Texture binding is spread
+ *  over the whole draw list, so it is only timed on the CPU.
+ ***********************************************************/
+void SceneManager::SetProfiler(FrameProfiler* pProfiler)
+{
+	m_pProfiler = pProfiler;
+	if (NULL == m_pProfiler)
+	{
+		return;
+	}
+
+	m_residencyTimer = m_pProfiler->AddTimer("TextureResidency", true);
+	m_renderTimers[RENDER_DRAW_LIST] = m_pProfiler->AddTimer("RenderDrawList", true);
+	m_renderTimers[RENDER_INSTANCED] = m_pProfiler->AddTimer("RenderInstanced", true);
+	m_renderTimers[RENDER_INDIRECT] = m_pProfiler->AddTimer("RenderIndirect", true);
+	m_textureBindTimer = m_pProfiler->AddTimer("TextureBinding", false);
+}
+
+/***********************************************************
+ *  SetViewParameters()
+ *
+ *  This method is used for setting the camera matrices,
+ *  position and viewport height of the current frame, used
+ *  for ordering draws, sizing streamed texture levels and
+ *  by the instanced shader program.
+ ***********************************************************/
+void SceneManager::SetViewParameters(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition,
+	int viewportHeight)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewPosition = viewPosition;
+	m_viewportHeight = viewportHeight;
+}
+
+/***********************************************************
+ *  SetInstancedShader()
+ *
+ *  This method is used for setting the shader program of
+ *  the instanced and indirect render modes.  The program
+ *  must be built from the instanced shaders, which read the
+ *  model matrix, color, material and texture slot of each
+ *  object from per-instance attributes.  Returns false when
+ *  the program is not usable.
+ ***********************************************************/
+bool SceneManager::SetInstancedShader(ShaderManager* pShaderManager)
+{
+	if (NULL == pShaderManager)
+	{
+		return(false);
+	}
+
+	// make sure the instanced program linked before using it
+	GLint programID = 0;
+	GLint linkStatus = GL_FALSE;
+	pShaderManager->use();
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	if (0 != programID)
+	{
+		glGetProgramiv((GLuint)programID, GL_LINK_STATUS, &linkStatus);
+	}
+	if ((linkStatus != GL_TRUE) || (!BindMaterialBlock((GLuint)programID)))
+	{
+		std::cout << "Instanced shader program is not usable" << std::endl;
+		m_pShaderManager->use();
+		return(false);
+	}
+
+	m_pInstancedShader = pShaderManager;
+	if (NULL != m_pInstancedUniforms)
+	{
+		delete m_pInstancedUniforms;
+	}
+	m_pInstancedUniforms = new UniformCache((GLuint)programID);
+	m_instancedViewUniform = m_pInstancedUniforms->GetHandle("view");
+	m_instancedProjectionUniform = m_pInstancedUniforms->GetHandle("projection");
+	m_instancedViewPositionUniform = m_pInstancedUniforms->GetHandle("viewPosition");
+
+	// the instanced program needs its own copy of the lights,
+	// and samples every texture from the array textures or
+	// through the bindless handles
+	SetupSceneLights(m_pInstancedShader);
+	for (int i = 0; i < TextureArrayManager::MAX_TEXTURE_ARRAYS; i++)
+	{
+		m_pInstancedShader->setSampler2DValue("textureArrays[" + std::to_string(i) + "]", ARRAY_TEXTURE_UNIT_BASE + i);
+	}
+	m_pInstancedShader->setBoolValue(g_UseBindlessName, m_bBindlessTexturesActive);
+	m_pShaderManager->use();
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetRenderMode()
+ *
+ *  This method is used for choosing how the scene objects
+ *  are submitted.  The instanced and indirect modes need the
+ *  instanced shader program, and the indirect mode needs
+ *  multi-draw indirect support.  Streamed textures are not
+ *  packed into the array textures, so the instanced modes
+ *  can only sample them through bindless handles.  When a
+ *  mode cannot be used it is left unchanged and false is
+ *  returned.
+ ***********************************************************/
+bool SceneManager::SetRenderMode(RENDER_MODE renderMode)
+{
+	if ((renderMode != RENDER_DRAW_LIST) && (NULL == m_pInstancedShader))
+	{
+		std::cout << "Instanced shader program is not loaded" << std::endl;
+		return(false);
+	}
+	if ((renderMode == RENDER_INDIRECT) && (!ShapeBuffer::IsIndirectSupported()))
+	{
+		std::cout << "Multi-draw indirect is not supported by this context" << std::endl;
+		return(false);
+	}
+	if ((renderMode != RENDER_DRAW_LIST) && (m_textureResidency.IsStreaming()) && (!m_bBindlessTexturesActive))
+	{
+		std::cout << "Streamed textures need bindless textures in the instanced render modes" << std::endl;
+		return(false);
+	}
+
+	m_renderMode = renderMode;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SubmitDrawList()
+ *
+ *  This method is used for drawing the visible scene objects
+ *  one at a time, in the order of the draw list recorded by
+ *  the update phase.
+ ***********************************************************/
+void SceneManager::SubmitDrawList()
+{
+	for (const DrawList::DRAW_COMMAND& command : m_drawList.GetCommands())
+	{
+		DrawSceneObject(command.objectIndex);
+	}
+}
+
+/***********************************************************
+ *  RenderInstanced()
+ *
+ *  This method is used for drawing the opaque visible scene
+ *  objects with instancing.  The objects are bucketed by mesh, and their
+ *  model matrix, color, UV scale, material index and texture
+ *  slot are gathered into the instance buffer in bucket
+ *  order.  Each mesh is then drawn with one instanced draw,
+ *  or every mesh at once with one multi-draw indirect call.
+ ***********************************************************/
+void SceneManager::RenderInstanced(bool bIndirect)
+{
+	// count the objects of each mesh to find where each
+	// mesh's run of instances starts
+	int instanceCounts[ShapeBuffer::SHAPE_COUNT] = { 0 };
+	int instanceStarts[ShapeBuffer::SHAPE_COUNT] = { 0 };
+	for (int i : m_instancedObjects)
+	{
+		instanceCounts[m_sceneObjects[i].meshType]++;
+	}
+	for (int i = 1; i < ShapeBuffer::SHAPE_COUNT; i++)
+	{
+		instanceStarts[i] = instanceStarts[i - 1] + instanceCounts[i - 1];
+	}
+
+	int nextInstance[ShapeBuffer::SHAPE_COUNT];
+	for (int i = 0; i < ShapeBuffer::SHAPE_COUNT; i++)
+	{
+		nextInstance[i] = instanceStarts[i];
+	}
+
+	m_instances.resize(m_instancedObjects.size());
+	for (int i : m_instancedObjects)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		ShapeBuffer::INSTANCE_DATA& instance = m_instances[nextInstance[object.meshType]++];
+		instance.model = m_transforms.GetMatrix(i);
+		instance.color = object.color;
+		instance.params = glm::vec4(
+			object.UVscale.x,
+			object.UVscale.y,
+			(float)std::max(object.materialIndex, 0),
+			(float)GetInstanceTextureParam(object.textureSlot));
+	}
+	m_shapeBuffer.UploadInstances(m_instances);
+
+	m_pInstancedShader->use();
+	m_pInstancedUniforms->SetMat4Value(m_instancedViewUniform, m_viewMatrix);
+	m_pInstancedUniforms->SetMat4Value(m_instancedProjectionUniform, m_projectionMatrix);
+	m_pInstancedUniforms->SetVec3Value(m_instancedViewPositionUniform, m_viewPosition);
 
+	if (bIndirect)
+	{
+		m_shapeBuffer.DrawIndirect(instanceCounts);
+		m_frameStats.drawCalls++;
+	}
+	else
+	{
+		for (int i = 0; i < ShapeBuffer::SHAPE_COUNT; i++)
+		{
+			if (instanceCounts[i] > 0)
+			{
+				m_shapeBuffer.DrawInstanced(i, instanceCounts[i], instanceStarts[i]);
+				m_frameStats.drawCalls++;
+			}
+		}
+	}
+
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  UpdateScene()
+ *
+ *  This method is used for preparing the frame without any
+ *  GL calls.  Transform composition, culling and sort key
+ *  generation are spread across the thread pool, so this
+ *  phase scales with the cores while the GL context stays
+ *  on the calling thread.
+ ***********************************************************/
+void SceneManager::UpdateScene()
+{
+	auto updateStart = std::chrono::high_resolution_clock::now();
+	m_frameStats = FRAME_STATS();
+
+	// only objects that moved since the last frame are recomposed
+	UpdateTransforms();
+	m_bSceneChanged = false;
+	// objects outside the view are not submitted at all
+	CullScene();
+	// streamed textures are sized for the visible objects
+	if (m_textureResidency.IsStreaming())
+	{
+		RequestTextureLevels();
+	}
+	// the instanced modes bucket the opaque visible objects by
+	// mesh instead, leaving only the translucent ones to the
+	// draw list
+	if (m_renderMode == RENDER_DRAW_LIST)
+	{
+		BuildDrawList(m_visibleObjects);
+	}
+	else
+	{
+		SplitTranslucentObjects();
+		BuildDrawList(m_translucentObjects);
+	}
+
+	auto updateEnd = std::chrono::high_resolution_clock::now();
+	m_frameStats.updateMilliseconds = std::chrono::duration<float, std::milli>(updateEnd - updateStart).count();
 }
 
 /***********************************************************
  *  RenderScene()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for submitting the scene prepared
+ *  by UpdateScene with the selected render mode.
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-	RenderFloor();
-	RenderCoffeeMaker();
-	RenderOranges();
-	RenderCoffeeMug();
-	RenderMilkCarton();
-}
-
-/***********************************************************
- *  RenderFloor()
- *
- *  This method is for rendering the 
- *  floor plane and its texture. 
- *  The texture is tiled wood btw...
- ***********************************************************/
-void SceneManager::RenderFloor()
-{
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(10.0f, 1.0f, 20.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// since were rotating just the floor, lets make a personal variable
-	float YrotationDegreesFloor = 90.0f;
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// draw the mesh with transformation values
-	// Floor plane mesh
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegreesFloor,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// draw the mesh with transformation values
-	// Floor plane mesh
-
-	// setting the texture of the floor plane to wood
-	SetShaderTexture("WoodFloor");
-	SetTextureUVScale(3.0, 3.0);
-	SetShaderMaterial("floor");
-	m_basicMeshes->DrawPlaneMesh();
-}
-
-
-/***********************************************************
- *  RenderCoffeeMaker()
- *
- *  This method is for rendering the complex object
- *  moka pot and its textures
- ***********************************************************/
-void SceneManager::RenderCoffeeMaker()
-{
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// bottom tapered cylinder for moka pot
-	scaleXYZ = glm::vec3(1.0f, 2.0f, 1.0f);
-	positionXYZ = glm::vec3(3.0f, 0.0f, 4.0f);
-	SetTransformations(
-		scaleXYZ,         // scale and size
-		XrotationDegrees, // flipping like a coin
-		180, // spinning like a top
-		ZrotationDegrees, //
-		positionXYZ       // positioning
-	);
-	SetShaderTexture("Aluminum"); // setting the texture of the bottom of moka pot to aluminum
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("cone");
-	m_basicMeshes->DrawTaperedCylinderMesh();
-
-	// middle cylinder section
-	scaleXYZ = glm::vec3(0.75f, 0.35f, 0.75f);
-	positionXYZ = glm::vec3(3.0f, 1.8f, 4.0f);
-	SetTransformations(
-		scaleXYZ,         // scale and size
-		180, // flipping like a coin
-		YrotationDegrees, // spinning like a top
-		ZrotationDegrees, //
-		positionXYZ       // positioning
-	);
-	SetShaderTexture("Aluminum");
-	//SetShaderColor(165.0f / 255.0f, 169.0f / 255.0f, 180.0f / 255.0f, 1.0f);
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("cylinder");
-	m_basicMeshes->DrawCylinderMesh();
-
-	// top tapered cylinder for moka pot (inverted)
-	scaleXYZ = glm::vec3(1.0f, 2.0f, 1.0f);
-	positionXYZ = glm::vec3(3.0f, 3.5f, 4.0f);
-	SetTransformations(
-		scaleXYZ,         // scale and size
-		180, // flipping like a coin
-		YrotationDegrees, // spinning like a top
-		ZrotationDegrees, //
-		positionXYZ       // positioning
-	);
-
-	// setting the texture of the moka pot to aluminum
-	SetShaderTexture("Aluminum");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("cone");
-	m_basicMeshes->DrawTaperedCylinderMesh();
-
-	// lid handle of the moka pot
-	SetShaderColor(111.0f / 255.0f, 78.0f / 255.0f, 55.0f / 255.0f, 1.0f);
-	scaleXYZ = glm::vec3(0.4f, 0.25f, 0.4f);
-	positionXYZ = glm::vec3(3.0f, 3.9f, 3.9f);
-	SetTransformations(
-		scaleXYZ,
-		90,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	SetShaderMaterial("coffee");
-	m_basicMeshes->DrawCylinderMesh();
-
-	// side handle for the moka pot (horizontal)
-	scaleXYZ = glm::vec3(1.4f, 0.25f, 0.4f);
-	positionXYZ = glm::vec3(4.0f, 3.3f, 4.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	SetShaderMaterial("coffee");
-	m_basicMeshes->DrawBoxMesh();
-
-	// side handle for the moka pot (horizontal)
-	scaleXYZ = glm::vec3(1.25f, 0.25f, 0.4f);
-	positionXYZ = glm::vec3(4.6f, 2.8f, 4.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		90,
-		positionXYZ
-	);
-	SetShaderMaterial("coffee");
-	m_basicMeshes->DrawBoxMesh();
-
-	// Spout for moka pot
-	scaleXYZ = glm::vec3(1.25f, 0.25f, 0.4f);
-	positionXYZ = glm::vec3(2.1f, 3.27f, 4.0f);
-	SetTransformations(
-		scaleXYZ,
-		90,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	// setting the texture of the moka pot spout to aluminum
-	SetShaderTexture("Aluminum");
-	SetTextureUVScale(3.0, 3.0);
-	SetShaderMaterial("cone");                   // may need to change 
-	m_basicMeshes->DrawPrismMesh();
-
-	// coloring the top of the spout coffee colored
-	scaleXYZ = glm::vec3(1.22f, 0.22f, 0.38f);
-	positionXYZ = glm::vec3(2.1f, 3.29f, 4.0f);
-	SetTransformations(
-		scaleXYZ,
-		90,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	// setting the texture of the moka pot to aluminum
-	SetShaderColor(111.0f / 255.0f, 78.0f / 255.0f, 55.0f / 255.0f, 1.0f);
-	SetShaderMaterial("coffee");              // need a coffee colored and matte material
-	m_basicMeshes->DrawPrismMesh();
-
-}
-
-
-/***********************************************************
- *  RenderOranges()
- *
- *  This method is for rendering the super ultra complex 
- *  object of two whole mandarin oranges.
- *  (that used to be plums but i like the oranges more) 
- *  ...WOW...
- ***********************************************************/
-void SceneManager::RenderOranges()
-{
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// Left mandarin orange
-	scaleXYZ = glm::vec3(0.75f, 0.75f, 0.75f);
-	positionXYZ = glm::vec3(-2.0f, 0.75f, 5.0f);
-	SetTransformations(
-		scaleXYZ,
-		90,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	// setting the texture of the orange
-	SetShaderTexture("Dirt");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("orange");
-	m_basicMeshes->DrawSphereMesh();
-
-	// Right mandarin orange
-	scaleXYZ = glm::vec3(0.75f, 0.75f, 0.75f);
-	positionXYZ = glm::vec3(-0.5f, 0.75f, 7.0f);
-	SetTransformations(
-		scaleXYZ,
-		90,
-		90, // rotating one orange to make them look a little different
-		ZrotationDegrees,
-		positionXYZ
-	);
-	SetTextureUVScale(-1.0, 1.0);
-	m_basicMeshes->DrawSphereMesh();
-}
-
-
-/***********************************************************
- *  RenderCoffeeMug()
- *
- *  This method is for rendering the complex
- *  object, coffee mug.
- *  
- ***********************************************************/
-void SceneManager::RenderCoffeeMug() 
-{
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// Mug Handle
-	scaleXYZ = glm::vec3(0.75f, 0.45f, 0.75f);
-	positionXYZ = glm::vec3(-4.7f, 1.40f, 6.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	// setting the color of the mug
-	SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
-	SetShaderMaterial("mug");
-	m_basicMeshes->DrawTorusMesh();
-
-	// Mug Body
-	scaleXYZ = glm::vec3(1.00f, 2.25f, 0.75f);
-	positionXYZ = glm::vec3(-5.5f, 0.00f, 6.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees, 
-		ZrotationDegrees,
-		positionXYZ
-	);
-	m_basicMeshes->DrawCylinderMesh();
-}
-
-
-
-/***********************************************************
- *  RenderMilkCarton()
- *
- *  This method is for rendering the complex
- *  object, Milk Carton.
- *
- ***********************************************************/
-void SceneManager::RenderMilkCarton()
-{
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = -20.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// Milk Carton Body
-	scaleXYZ = glm::vec3(3.00f, 6.00f, 3.00f);
-	positionXYZ = glm::vec3(-3.0f, 3.00f, 0.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
-	// setting the texture of the milk carton
-	SetShaderColor(1.0f, 0.9f, 1.0f, 1.0f);
-	SetShaderMaterial("box");
-	m_basicMeshes->DrawBoxMesh();
-
-	// Carton Top (inside portion)
-	scaleXYZ = glm::vec3(3.0f, 3.0f, 1.0f);
-	positionXYZ = glm::vec3(-3.0f, 6.5f, 0.0f);
-	SetTransformations(
-		scaleXYZ,
-		-90,
-		0,
-		-110,
-		positionXYZ
-	);
-	m_basicMeshes->DrawPrismMesh();
-
-	// Carton Top (tab)
-	scaleXYZ = glm::vec3(2.95f, 0.50f, 0.10f);
-	positionXYZ = glm::vec3(-3.0f, 7.15f, 0.0f);
-	SetTransformations(
-		scaleXYZ,
-		0,
-		-20,
-		0,
-		positionXYZ
-	);
-	m_basicMeshes->DrawBoxMesh();
-
-	// carton lid
-	scaleXYZ = glm::vec3(0.25f, 0.25f, 0.25f);
-	positionXYZ = glm::vec3(-3.3f, 6.35f, 0.90f);
-	SetTransformations(
-		scaleXYZ,
-		30,
-		0,
-		15,
-		positionXYZ
-	);
-	m_basicMeshes->DrawCylinderMesh();
+	if (m_textureResidency.IsStreaming())
+	{
+		FrameProfiler::ScopedTimer timer(m_pProfiler, m_residencyTimer);
+		UpdateTextureResidency();
+	}
+
+	{
+		FrameProfiler::ScopedTimer timer(m_pProfiler, m_renderTimers[m_renderMode]);
+		switch (m_renderMode)
+		{
+		case RENDER_INSTANCED:
+			RenderInstanced(false);
+			SubmitDrawList();
+			break;
+		case RENDER_INDIRECT:
+			RenderInstanced(true);
+			SubmitDrawList();
+			break;
+		default:
+			SubmitDrawList();
+			break;
+		}
+	}
+
+	if (NULL != m_pUniformCache)
+	{
+		m_frameStats.uniformLookups = m_pUniformCache->GetLookupCount();
+		m_frameStats.stateChangesSubmitted = m_pUniformCache->GetSubmittedCount();
+		m_frameStats.stateChangesSkipped = m_pUniformCache->GetSkippedCount();
+	}
+	if (NULL != m_pInstancedUniforms)
+	{
+		m_frameStats.uniformLookups += m_pInstancedUniforms->GetLookupCount();
+		m_frameStats.stateChangesSubmitted += m_pInstancedUniforms->GetSubmittedCount();
+		m_frameStats.stateChangesSkipped += m_pInstancedUniforms->GetSkippedCount();
+		m_pInstancedUniforms->BeginFrame();
+	}
 }
\ No newline at end of file
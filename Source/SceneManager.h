@@ -11,8 +11,19 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "DrawList.h"
+#include "FrameProfiler.h"
+#include "ShapeBuffer.h"
+#include "SceneBVH.h"
+#include "TransformStore.h"
+#include "ThreadPool.h"
+#include "TextureLoader.h"
+#include "TextureArrayManager.h"
+#include "TextureResidencyManager.h"
+#include "UniformCache.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -25,7 +36,7 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, UniformCache *pUniformCache);
 	// destructor
 	~SceneManager();
 
@@ -33,6 +44,15 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// array texture and layer holding the texture, the
+		// array index is -1 for a standalone texture
+		int arrayIndex;
+		int layer;
+		// resident bindless handle, 0 when bindless textures
+		// are not in use
+		GLuint64 handle;
+		// true when the image has an alpha channel
+		bool bAlpha;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,38 +65,275 @@ public:
 		std::string tag;
 	};
 
+	// std140 layout of one material in the material uniform
+	// buffer, matching the shader declaration
+	//
+	//   struct MaterialData { vec4 ambient; vec4 diffuse; vec4 specular; };
+	//   layout(std140) uniform MaterialBlock
+	//   {
+	//       MaterialData materials[256];
+	//       uvec4 textureHandles[256];
+	//   };
+	//   uniform int materialIndex;
+	//
+	// textureHandles holds the bindless handle of each texture
+	// slot in xy.  A scene shader that also declares
+	//
+	//   uniform bool bUseBindlessTextures;
+	//   uniform int textureIndex;
+	//
+	// samples sampler2D(textureHandles[textureIndex].xy) in
+	// bindless mode, so no texture is bound per draw.
+	struct MATERIAL_BLOCK_ENTRY
+	{
+		// rgb ambient color, a ambient strength
+		glm::vec4 ambient;
+		// rgb diffuse color, a unused
+		glm::vec4 diffuse;
+		// rgb specular color, a shininess
+		glm::vec4 specular;
+	};
+
+	// basic shape meshes that scene objects can be drawn with
+	enum MESH_TYPE
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MESH_PRISM,
+		MESH_SPHERE,
+		MESH_PYRAMID4,
+		MESH_TYPE_COUNT
+	};
+
+	// one entry of the scene table loaded from the scene file
+	struct SCENE_OBJECT
+	{
+		MESH_TYPE meshType;
+		std::string materialTag;
+		// empty when the object is drawn with a solid color
+		std::string textureTag;
+		// handles resolved from the tags when the scene is loaded,
+		// -1 when the tag is unknown or unused
+		int materialIndex;
+		int textureSlot;
+		glm::vec2 UVscale;
+		glm::vec4 color;
+		// world space bounds, rebuilt with the model matrix
+		SceneBVH::BOUNDING_BOX worldBounds;
+		// true when the color or texture can be see-through, so
+		// the object is blended after the opaque objects
+		bool bTranslucent;
+	};
+
+	// ways the scene objects can be submitted
+	enum RENDER_MODE
+	{
+		// one draw per object, ordered by the draw list
+		RENDER_DRAW_LIST = 0,
+		// one instanced draw per mesh
+		RENDER_INSTANCED,
+		// one multi-draw indirect call for the whole scene
+		RENDER_INDIRECT
+	};
+
+	// counters collected while rendering a single frame
+	struct FRAME_STATS
+	{
+		// number of model matrices recomposed this frame
+		int rebuiltMatrices;
+		// number of uniform location lookups this frame
+		int uniformLookups;
+		// uniform and texture state changes passed on to OpenGL
+		int stateChangesSubmitted;
+		// identical state changes filtered out this frame
+		int stateChangesSkipped;
+		// number of meshes drawn this frame
+		int drawCalls;
+		// objects inside and outside the view frustum
+		int visibleObjects;
+		int culledObjects;
+		// CPU time of the update phase, which issues no GL calls
+		float updateMilliseconds;
+		// video memory of the streamed textures, and the textures
+		// streamed finer and trimmed this frame
+		size_t textureResidentBytes;
+		int texturesStreamed;
+		int texturesEvicted;
+	};
+
+	// handles of the uniforms set while rendering
+	struct UNIFORM_HANDLES
+	{
+		int model;
+		int objectColor;
+		int objectTexture;
+		int useTexture;
+		int useLighting;
+		int UVscale;
+		int materialAmbientColor;
+		int materialAmbientStrength;
+		int materialDiffuseColor;
+		int materialSpecularColor;
+		int materialShininess;
+		int materialIndex;
+		int textureIndex;
+		int useBindlessTextures;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the uniform location cache of the shader program
+	UniformCache* m_pUniformCache;
+	// uniform handles resolved from the uniform cache
+	UNIFORM_HANDLES m_uniforms;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// loaded textures info, indexed by texture slot
+	std::vector<TEXTURE_INFO> m_textureIDs;
+	// array textures holding the loaded textures
+	TextureArrayManager m_textureArrays;
+	// resident mip levels of the streamed textures
+	TextureResidencyManager m_textureResidency;
+	// residency changes applied this frame
+	std::vector<TextureResidencyManager::RESIDENCY_CHANGE> m_residencyChanges;
+	// viewport height the texture levels are chosen for
+	int m_viewportHeight;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// uniform buffer holding every defined material
+	GLuint m_materialBuffer;
+	// true when the shader declares the material block, so
+	// materials are selected by index instead of uploaded
+	bool m_bMaterialBufferActive;
+	// tag to handle lookup tables, filled when textures and
+	// materials are created
+	std::unordered_map<std::string, int> m_textureSlots;
+	std::unordered_map<std::string, int> m_materialIndices;
+	// objects loaded from the scene file, drawn in order
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// transforms and model matrices of the scene objects,
+	// stored at the same index as the object
+	TransformStore m_transforms;
+	// indices of the transforms rebuilt this frame
+	std::vector<int> m_rebuiltTransforms;
+	// counters for the most recently rendered frame
+	FRAME_STATS m_frameStats;
+	// draw commands recorded for the current frame
+	DrawList m_drawList;
+	// when false, draws are submitted in scene table order
+	bool m_bSortDrawList;
+	// camera matrices and position for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	glm::vec3 m_viewPosition;
+
+	// shared geometry of the basic shapes, captured from the
+	// ShapeMeshes meshes, for instanced drawing and culling
+	ShapeBuffer m_shapeBuffer;
+	// shader program and uniform cache for instanced drawing
+	ShaderManager* m_pInstancedShader;
+	UniformCache* m_pInstancedUniforms;
+	// uniform handles of the instanced shader program
+	int m_instancedViewUniform;
+	int m_instancedProjectionUniform;
+	int m_instancedViewPositionUniform;
+	// per-instance data gathered for the current frame
+	std::vector<ShapeBuffer::INSTANCE_DATA> m_instances;
+	// how the scene objects are submitted
+	RENDER_MODE m_renderMode;
+
+	// hierarchy over the object bounds, rebuilt when objects move
+	SceneBVH m_sceneBVH;
+	bool m_bBVHDirty;
+	// true when objects were moved since the last rendered frame
+	bool m_bSceneChanged;
+	// indices of the objects drawn this frame
+	std::vector<int> m_visibleObjects;
+	// visible objects of the instanced modes, split into those
+	// drawn instanced and the translucent ones drawn through
+	// the draw list after them
+	std::vector<int> m_instancedObjects;
+	std::vector<int> m_translucentObjects;
+	// when false, every object is drawn
+	bool m_bFrustumCulling;
+
+	// workers for the update phase, NULL runs it on the
+	// calling thread
+	ThreadPool* m_pThreadPool;
+	// per-chunk results of the parallel update phase
+	std::vector<std::vector<int>> m_chunkResults;
+	// subtrees of the hierarchy culled in parallel
+	std::vector<int> m_cullSubtrees;
+	// load textures through the texture cache files
+	bool m_bUseTextureCache;
+	// block compress textures when S3TC is supported
+	bool m_bCompressTextures;
+	// sample textures through bindless handles when supported
+	bool m_bBindlessTextures;
+	// true once every texture has a resident bindless handle
+	// in the material buffer
+	bool m_bBindlessTexturesActive;
+	// pass timers, NULL when the frame is not profiled
+	FrameProfiler* m_pProfiler;
+	int m_residencyTimer;
+	int m_textureBindTimer;
+	// submission timer of each render mode
+	int m_renderTimers[RENDER_INDIRECT + 1];
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	// decode the queued image files in parallel and upload them
+	void CreateGLTextures(TextureLoader& loader);
+	// create an OpenGL texture from a decoded image
+	bool UploadGLTexture(const TextureLoader::DECODED_IMAGE& image, GLuint& textureID, int firstLevel);
+	// store a created texture in the next slot
+	void RegisterTexture(GLuint textureID, const std::string& tag, int arrayIndex, int layer, bool bAlpha);
+	// make every texture resident and store its bindless handle
+	// in the material buffer
+	void CreateBindlessTextures();
+	void StoreBindlessHandle(int textureSlot);
+	// true when the scene shader reads the texture handles from
+	// the material buffer through the texture index uniform
+	bool IsShaderTextureIndexed() const;
+	// true when textures are block compressed on load
+	bool IsTextureCompressionActive();
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureSlot(const std::string& tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
 
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
+	// set a precomposed model matrix into the shader
+	void SetModelMatrix(const glm::mat4& modelMatrix);
+
+	// recompose the model matrices of objects marked dirty
+	void UpdateTransforms();
+	// get the object space bounds of a basic shape
+	SceneBVH::BOUNDING_BOX GetMeshBounds(int meshType) const;
+	// collect the objects inside the view frustum
+	void CullScene();
+	// ask for the mip levels the visible objects need
+	void RequestTextureLevels();
+	// stream and trim texture levels within the budget
+	void UpdateTextureResidency();
+	// check whether a scene object has to be blended
+	bool IsObjectTranslucent(const SCENE_OBJECT& object) const;
+	// split the visible objects between the instanced draws
+	// and the draw list
+	void SplitTranslucentObjects();
+	// record and sort the draw commands of the passed in objects
+	void BuildDrawList(const std::vector<int>& objects);
+	// run a loop of the update phase on the thread pool
+	void ParallelFor(int count, int grainSize, const ThreadPool::RANGE_FUNCTION& body);
+	// empty the per-chunk results before a parallel loop
+	void PrepareChunkResults(int chunkCount);
+	// append the per-chunk results in chunk order
+	void MergeChunkResults(int chunkCount, std::vector<int>& results);
 
 	// set the color values into the shader
 	void SetShaderColor(
@@ -87,7 +344,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		int textureSlot);
+	// texture parameter of a slot for the instanced shader
+	int GetInstanceTextureParam(int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -95,24 +354,91 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		int materialIndex);
+
+	// resolve the handles of the uniforms set while rendering
+	void ResolveUniforms();
+	// upload the defined materials into the material uniform buffer
+	void CreateMaterialBuffer();
+	// connect a shader program to the material uniform buffer
+	bool BindMaterialBlock(GLuint programID);
+
+	// load the scene object table from a scene file
+	bool LoadSceneFile(const char* filename);
+	// draw the basic shape mesh of the passed in type
+	void DrawMesh(MESH_TYPE meshType);
+	// set the state of a scene object into the shader and draw it
+	void DrawSceneObject(int objectIndex);
+	// draw the scene objects one at a time in draw list order
+	void SubmitDrawList();
+	// draw the opaque scene objects with one instanced draw per
+	// mesh, or with one multi-draw indirect call
+	void RenderInstanced(bool bIndirect);
 
 public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
-	void PrepareScene();
+	bool PrepareScene(const char* sceneFilename);
+	// update phase, composes transforms, culls and records the
+	// draw list without touching OpenGL
+	void UpdateScene();
+	// submission phase, issues the GL calls for the updated
+	// scene on the thread that owns the context
 	void RenderScene();
 	void CreateSceneTextures();
 
-	// methods for rendering objects for organizational purposes
-	void RenderFloor();
-	void RenderCoffeeMaker();
-	void RenderOranges();
-	void RenderCoffeeMug();
-	void RenderMilkCarton();
+	// move a scene object, its model matrix is rebuilt on the next frame
+	void SetObjectTransform(
+		int objectIndex,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+	// replace the scene table with randomly placed objects
+	void GenerateScene(int objectCount, unsigned int seed);
+	// number of objects in the scene table
+	int GetObjectCount() const { return (int)m_sceneObjects.size(); }
+	// true when the next frame would differ from the last one
+	// even with the same view, because objects were moved or
+	// texture levels are still being streamed in
+	bool NeedsRedraw() const { return (m_bSceneChanged) || (!m_residencyChanges.empty()); }
+	// enable or disable sorting the draw list by render state
+	void SetDrawListSorting(bool bSort) { m_bSortDrawList = bSort; }
+	// set the camera matrices, position and viewport height for
+	// the current frame
+	void SetViewParameters(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition,
+		int viewportHeight);
+	// set the instanced shader program used by the instanced
+	// and indirect render modes
+	bool SetInstancedShader(ShaderManager* pShaderManager);
+	// choose how the scene objects are submitted
+	bool SetRenderMode(RENDER_MODE renderMode);
+	// enable or disable skipping objects outside the view
+	void SetFrustumCulling(bool bCull) { m_bFrustumCulling = bCull; }
+	// set the workers used by the update phase
+	void SetThreadPool(ThreadPool* pThreadPool) { m_pThreadPool = pThreadPool; }
+	// add the timers of the render passes to the passed in
+	// profiler
+	void SetProfiler(FrameProfiler* pProfiler);
+	// read and write texture cache files, before PrepareScene
+	void SetTextureCache(bool bUseCache) { m_bUseTextureCache = bUseCache; }
+	// block compress textures on load, before PrepareScene
+	void SetTextureCompression(bool bCompress) { m_bCompressTextures = bCompress; }
+	// stream texture levels within a video memory budget, 0
+	// keeps every level resident, before PrepareScene
+	void SetTextureBudget(size_t budgetBytes) { m_textureResidency.SetBudget(budgetBytes); }
+	// sample textures through bindless handles when the driver
+	// supports them, before PrepareScene
+	void SetBindlessTextures(bool bBindless) { m_bBindlessTextures = bBindless; }
+	// true when textures are sampled through bindless handles
+	bool IsBindlessTextureActive() const { return m_bBindlessTexturesActive; }
+	// counters for the most recently rendered frame
+	const FRAME_STATS& GetFrameStats() const { return m_frameStats; }
 
 	// methods for defining materials and light
 	void DefineObjectMaterials();
-	void SetupSceneLights();
+	void SetupSceneLights(ShaderManager* pShaderManager);
 };
\ No newline at end of file
@@ -0,0 +1,444 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapebuffer.cpp
+// ============
+// shared vertex and index buffer holding every basic shape mesh
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeBuffer.h"
+
+#include <cstddef>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// program recording the object space vertices of a shape,
+	// its outputs are interleaved in the layout of VERTEX
+	const char* g_CaptureVertexShader =
+		"#version 330 core\n"
+		"layout (location = 0) in vec3 inVertexPosition;\n"
+		"layout (location = 1) in vec3 inVertexNormal;\n"
+		"layout (location = 2) in vec2 inTextureCoordinate;\n"
+		"out vec3 capturePosition;\n"
+		"out vec3 captureNormal;\n"
+		"out vec2 captureUV;\n"
+		"void main()\n"
+		"{\n"
+		"	capturePosition = inVertexPosition;\n"
+		"	captureNormal = inVertexNormal;\n"
+		"	captureUV = inTextureCoordinate;\n"
+		"	gl_Position = vec4(inVertexPosition, 1.0);\n"
+		"}\n";
+	const char* g_CaptureVaryings[] = { "capturePosition", "captureNormal", "captureUV" };
+
+	// attribute locations of the ShapeMeshes meshes, also read
+	// by the capture program and the instanced vertex shader
+	const GLuint POSITION_ATTRIBUTE = 0;
+	const GLuint NORMAL_ATTRIBUTE = 1;
+	const GLuint UV_ATTRIBUTE = 2;
+	const GLuint INSTANCE_MODEL_ATTRIBUTE = 3;
+	const GLuint INSTANCE_COLOR_ATTRIBUTE = 7;
+	const GLuint INSTANCE_PARAMS_ATTRIBUTE = 8;
+}
+
+/***********************************************************
+ *  ShapeBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShapeBuffer::ShapeBuffer()
+{
+	m_vao = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_instanceBuffer = 0;
+	m_indirectBuffer = 0;
+	m_instanceCapacity = 0;
+	m_meshFirstVertex = 0;
+	for (int i = 0; i < SHAPE_COUNT; i++)
+	{
+		m_meshRanges[i] = MESH_RANGE();
+	}
+}
+
+/***********************************************************
+ *  ~ShapeBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShapeBuffer::~ShapeBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for capturing the geometry of every
+ *  basic shape, packing it into shared vertex and index
+ *  buffers, and configuring the vertex array object with
+ *  the per-vertex and per-instance attributes.  The passed
+ *  in function draws one shape, by MESH_TYPE, with the
+ *  meshes the draw list uses.  Returns false when the
+ *  shapes could not be captured.
+ ***********************************************************/
+bool ShapeBuffer::Create(const std::function<void(int meshType)>& drawShape)
+{
+	if (IsCreated())
+	{
+		return(true);
+	}
+
+	m_vertices.clear();
+	m_indices.clear();
+
+	if (!CaptureShapes(drawShape))
+	{
+		m_vertices.clear();
+		m_indices.clear();
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	// per-vertex attributes
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(VERTEX), m_vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+	glVertexAttribPointer(POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, position));
+	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
+	glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, normal));
+	glEnableVertexAttribArray(UV_ATTRIBUTE);
+	glVertexAttribPointer(UV_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, uv));
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLuint), m_indices.data(), GL_STATIC_DRAW);
+
+	// per-instance attributes, the model matrix takes four
+	// consecutive locations, one for each column
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(INSTANCE_MODEL_ATTRIBUTE + column);
+		glVertexAttribPointer(INSTANCE_MODEL_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA),
+			(void*)(offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(INSTANCE_MODEL_ATTRIBUTE + column, 1);
+	}
+	glEnableVertexAttribArray(INSTANCE_COLOR_ATTRIBUTE);
+	glVertexAttribPointer(INSTANCE_COLOR_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA), (void*)offsetof(INSTANCE_DATA, color));
+	glVertexAttribDivisor(INSTANCE_COLOR_ATTRIBUTE, 1);
+	glEnableVertexAttribArray(INSTANCE_PARAMS_ATTRIBUTE);
+	glVertexAttribPointer(INSTANCE_PARAMS_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA), (void*)offsetof(INSTANCE_DATA, params));
+	glVertexAttribDivisor(INSTANCE_PARAMS_ATTRIBUTE, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "Created shape buffer, vertices:" << m_vertices.size() << ", indices:" << m_indices.size() << std::endl;
+
+	// the geometry now lives on the GPU
+	m_vertices.clear();
+	m_vertices.shrink_to_fit();
+	m_indices.clear();
+	m_indices.shrink_to_fit();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the GPU buffers.
+ ***********************************************************/
+void ShapeBuffer::Destroy()
+{
+	if (0 != m_indirectBuffer)
+	{
+		glDeleteBuffers(1, &m_indirectBuffer);
+		m_indirectBuffer = 0;
+	}
+	if (0 != m_instanceBuffer)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	if (0 != m_indexBuffer)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	if (0 != m_vertexBuffer)
+	{
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (0 != m_vao)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	m_instanceCapacity = 0;
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for replacing the per-instance data.
+ *  The buffer only grows, so a steady instance count does
+ *  not reallocate GPU memory every frame.
+ ***********************************************************/
+void ShapeBuffer::UploadInstances(const std::vector<INSTANCE_DATA>& instances)
+{
+	if ((!IsCreated()) || (instances.size() == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	if ((int)instances.size() > m_instanceCapacity)
+	{
+		m_instanceCapacity = (int)instances.size();
+		glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(INSTANCE_DATA), instances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for drawing instances of one shape,
+ *  starting at the passed in instance of the last upload.
+ ***********************************************************/
+void ShapeBuffer::DrawInstanced(int meshType, int instanceCount, int baseInstance)
+{
+	if ((!IsCreated()) || (meshType < 0) || (meshType >= SHAPE_COUNT) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	const MESH_RANGE& range = m_meshRanges[meshType];
+
+	glBindVertexArray(m_vao);
+	glDrawElementsInstancedBaseVertexBaseInstance(
+		GL_TRIANGLES,
+		range.indexCount,
+		GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(GLuint)),
+		instanceCount,
+		range.baseVertex,
+		baseInstance);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  IsIndirectSupported()
+ *
+ *  This method is used for checking whether the current
+ *  context can draw with glMultiDrawElementsIndirect.
+ ***********************************************************/
+bool ShapeBuffer::IsIndirectSupported()
+{
+	return(GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect);
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing every shape with one
+ *  call.  A command per shape is written to the indirect
+ *  buffer, pointing at that shape's index range and at its
+ *  run of instances, and the whole buffer is submitted with
+ *  glMultiDrawElementsIndirect.
+ ***********************************************************/
+void ShapeBuffer::DrawIndirect(const int instanceCounts[SHAPE_COUNT])
+{
+	if (!IsCreated())
+	{
+		return;
+	}
+
+	DRAW_ELEMENTS_COMMAND commands[SHAPE_COUNT];
+	GLuint baseInstance = 0;
+	for (int i = 0; i < SHAPE_COUNT; i++)
+	{
+		commands[i].count = m_meshRanges[i].indexCount;
+		commands[i].instanceCount = (GLuint)instanceCounts[i];
+		commands[i].firstIndex = m_meshRanges[i].firstIndex;
+		commands[i].baseVertex = m_meshRanges[i].baseVertex;
+		commands[i].baseInstance = baseInstance;
+		baseInstance += (GLuint)instanceCounts[i];
+	}
+
+	if (0 == m_indirectBuffer)
+	{
+		glGenBuffers(1, &m_indirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(commands), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(commands), commands);
+
+	glBindVertexArray(m_vao);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, SHAPE_COUNT, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BeginMesh()
+ *
+ *  This method is used for starting the range of a shape
+ *  in the shared buffers.
+ ***********************************************************/
+void ShapeBuffer::BeginMesh(int meshType)
+{
+	m_meshFirstVertex = (GLuint)m_vertices.size();
+	m_meshRanges[meshType].firstIndex = (GLuint)m_indices.size();
+	m_meshRanges[meshType].baseVertex = (GLint)m_meshFirstVertex;
+}
+
+/***********************************************************
+ *  EndMesh()
+ *
+ *  This method is used for finishing the range of a shape
+ *  and taking its bounds from the vertices it added.
+ ***********************************************************/
+void ShapeBuffer::EndMesh(int meshType)
+{
+	MESH_RANGE& range = m_meshRanges[meshType];
+	range.indexCount = (GLuint)m_indices.size() - range.firstIndex;
+
+	range.boundsMin = glm::vec3(0.0f);
+	range.boundsMax = glm::vec3(0.0f);
+	for (size_t i = m_meshFirstVertex; i < m_vertices.size(); i++)
+	{
+		const glm::vec3& position = m_vertices[i].position;
+		if (i == m_meshFirstVertex)
+		{
+			range.boundsMin = position;
+			range.boundsMax = position;
+		}
+		range.boundsMin = glm::min(range.boundsMin, position);
+		range.boundsMax = glm::max(range.boundsMax, position);
+	}
+}
+
+/***********************************************************
+ *  CaptureShapes()
+ *
+ *  This method is used for recording the triangles of every
+ *  shape with transform feedback.  Each shape is drawn twice
+ *  with rasterization discarded, once to count its triangles
+ *  and once to record them, so the strips and fans the
+ *  meshes are drawn with arrive as independent triangles in
+ *  object space.  The recorded vertices are read back into
+ *  the geometry being built, indexed in order.
+ ***********************************************************/
+bool ShapeBuffer::CaptureShapes(const std::function<void(int meshType)>& drawShape)
+{
+	GLuint captureProgram = CreateCaptureProgram();
+	if (0 == captureProgram)
+	{
+		return(false);
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(captureProgram);
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	GLuint query = 0;
+	GLuint captureBuffer = 0;
+	glGenQueries(1, &query);
+	glGenBuffers(1, &captureBuffer);
+
+	bool bCaptured = true;
+	for (int meshType = 0; meshType < SHAPE_COUNT; meshType++)
+	{
+		// count the triangles of the shape
+		GLuint triangleCount = 0;
+		glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+		drawShape(meshType);
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT, &triangleCount);
+		if (triangleCount == 0)
+		{
+			std::cout << "Shape " << meshType << " drew no triangles to capture" << std::endl;
+			bCaptured = false;
+			break;
+		}
+
+		// record them
+		GLuint vertexCount = triangleCount * 3;
+		glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, captureBuffer);
+		glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, vertexCount * sizeof(VERTEX), NULL, GL_STREAM_READ);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, captureBuffer);
+		glBeginTransformFeedback(GL_TRIANGLES);
+		drawShape(meshType);
+		glEndTransformFeedback();
+
+		BeginMesh(meshType);
+		m_vertices.resize(m_meshFirstVertex + vertexCount);
+		glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vertexCount * sizeof(VERTEX), &m_vertices[m_meshFirstVertex]);
+		for (GLuint i = 0; i < vertexCount; i++)
+		{
+			m_indices.push_back(i);
+		}
+		EndMesh(meshType);
+	}
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+	glDeleteBuffers(1, &captureBuffer);
+	glDeleteQueries(1, &query);
+	glDisable(GL_RASTERIZER_DISCARD);
+	glUseProgram((GLuint)previousProgram);
+	glDeleteProgram(captureProgram);
+
+	return(bCaptured);
+}
+
+/***********************************************************
+ *  CreateCaptureProgram()
+ *
+ *  This method is used for linking the vertex-only program
+ *  whose outputs are recorded by CaptureShapes.  Returns 0
+ *  when the program does not compile or link.
+ ***********************************************************/
+GLuint ShapeBuffer::CreateCaptureProgram()
+{
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &g_CaptureVertexShader, NULL);
+	glCompileShader(vertexShader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		std::cout << "Shape capture shader did not compile" << std::endl;
+		glDeleteShader(vertexShader);
+		return(0);
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glTransformFeedbackVaryings(program, 3, g_CaptureVaryings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(program);
+	glDetachShader(program, vertexShader);
+	glDeleteShader(vertexShader);
+
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		std::cout << "Shape capture program did not link" << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapebuffer.h
+// ============
+// shared vertex and index buffer holding every basic shape mesh
+//
+//  The basic shapes are captured from the ShapeMeshes draw calls and packed
+//  into one vertex array object, so that many copies of a shape can be drawn
+//  with a single instanced draw command using per-instance attributes.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  ShapeBuffer
+ *
+ *  This class contains the packed geometry of the basic
+ *  shapes and the per-instance attribute buffer.  Shapes are
+ *  identified by their SceneManager::MESH_TYPE value.  The
+ *  geometry is recorded from the draw calls of the meshes
+ *  the draw list renders, so every render mode draws, and
+ *  culls with the bounds of, the same triangles.
+ ***********************************************************/
+class ShapeBuffer
+{
+public:
+	// constructor
+	ShapeBuffer();
+	// destructor
+	~ShapeBuffer();
+
+	// number of shapes held in the buffer, in MESH_TYPE order
+	static const int SHAPE_COUNT = 8;
+
+	// location and object space bounds of one shape inside the
+	// shared buffers
+	struct MESH_RANGE
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// per-instance attributes, read by the instanced vertex
+	// shader at locations 3 through 8
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		// xy UV scale, z material index, w texture slot plus one,
+		// 0 when the instance uses its color
+		glm::vec4 params;
+	};
+
+	// capture the geometry of every shape drawn by the passed
+	// in function and upload it to the GPU
+	bool Create(const std::function<void(int meshType)>& drawShape);
+	// free the GPU buffers
+	void Destroy();
+
+	// replace the per-instance attribute data
+	void UploadInstances(const std::vector<INSTANCE_DATA>& instances);
+	// draw a range of the uploaded instances with one shape
+	void DrawInstanced(int meshType, int instanceCount, int baseInstance);
+	// draw the uploaded instances of every shape with a single
+	// multi-draw indirect command, the instances of each shape
+	// following those of the previous shape
+	void DrawIndirect(const int instanceCounts[SHAPE_COUNT]);
+	// true when the context supports multi-draw indirect
+	static bool IsIndirectSupported();
+
+	const MESH_RANGE& GetMeshRange(int meshType) const { return m_meshRanges[meshType]; }
+	bool IsCreated() const { return m_vao != 0; }
+
+private:
+	// layout of one command in the indirect buffer
+	struct DRAW_ELEMENTS_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// matches the interleaved outputs of the capture program
+	struct VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// vertex array object and its buffers
+	GLuint m_vao;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	GLuint m_instanceBuffer;
+	GLuint m_indirectBuffer;
+	// number of instances the instance buffer can hold
+	int m_instanceCapacity;
+	// location of every shape in the shared buffers
+	MESH_RANGE m_meshRanges[SHAPE_COUNT];
+
+	// geometry being built by Create()
+	std::vector<VERTEX> m_vertices;
+	std::vector<GLuint> m_indices;
+
+	// record the triangles of every shape into the geometry
+	// being built
+	bool CaptureShapes(const std::function<void(int meshType)>& drawShape);
+	// link the vertex-only program whose outputs are recorded
+	static GLuint CreateCaptureProgram();
+
+	// start and finish the range of a shape
+	void BeginMesh(int meshType);
+	void EndMesh(int meshType);
+
+	// first vertex of the shape currently being built
+	GLuint m_meshFirstVertex;
+};
@@ -0,0 +1,274 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearraymanager.cpp
+// ============
+// pack the scene textures into layers of 2D array textures
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureArrayManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+/***********************************************************
+ *  TextureArrayManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrayManager::TextureArrayManager()
+{
+	m_maxLayers = MAX_ARRAY_LAYERS;
+}
+
+/***********************************************************
+ *  ~TextureArrayManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureArrayManager::~TextureArrayManager()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking that the driver can
+ *  create immutable array textures and views of their
+ *  layers, both core in OpenGL 4.3.
+ ***********************************************************/
+bool TextureArrayManager::IsSupported()
+{
+	return((GLEW_VERSION_4_3) || ((GLEW_ARB_texture_storage) && (GLEW_ARB_texture_view)));
+}
+
+/***********************************************************
+ *  GetInternalFormat()
+ *
+ *  This method is used for choosing the GL internal format
+ *  matching how an image is stored.
+ ***********************************************************/
+GLenum TextureArrayManager::GetInternalFormat(int channels, TextureCache::PIXEL_FORMAT format)
+{
+	switch (format)
+	{
+	case TextureCache::FORMAT_BC1:
+		return(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+	case TextureCache::FORMAT_BC3:
+		return(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+	default:
+		break;
+	}
+
+	return((channels == 4) ? GL_RGBA8 : GL_RGB8);
+}
+
+/***********************************************************
+ *  FindArray()
+ *
+ *  This method is used for finding an array with room left
+ *  whose layers match the size, format and mip count of
+ *  the passed in image.
+ ***********************************************************/
+int TextureArrayManager::FindArray(const TextureLoader::DECODED_IMAGE& image) const
+{
+	for (int i = 0; i < (int)m_arrays.size(); i++)
+	{
+		const ARRAY_TEXTURE& array = m_arrays[i];
+		if ((array.width == image.width) &&
+			(array.height == image.height) &&
+			(array.levelCount == (int)image.levels.size()) &&
+			(array.channels == image.channels) &&
+			(array.format == image.format) &&
+			(array.layerCount < m_maxLayers))
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for grouping the decoded images by
+ *  size and format, allocating one immutable array texture
+ *  per group, uploading every image into its layer and
+ *  creating a 2D view of each layer.  Images that fit no
+ *  array, once MAX_TEXTURE_ARRAYS groups exist, are left
+ *  with an array index of -1 for the caller to upload.
+ ***********************************************************/
+void TextureArrayManager::Build(
+	const std::vector<TextureLoader::DECODED_IMAGE>& images,
+	std::vector<TEXTURE_LOCATION>& locations)
+{
+	Destroy();
+
+	GLint driverMaxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &driverMaxLayers);
+	m_maxLayers = std::min((int)driverMaxLayers, (int)MAX_ARRAY_LAYERS);
+	if (m_maxLayers <= 0)
+	{
+		m_maxLayers = MAX_ARRAY_LAYERS;
+	}
+
+	// assign every image an array and layer
+	locations.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		const TextureLoader::DECODED_IMAGE& image = images[i];
+		TEXTURE_LOCATION& location = locations[i];
+		location.arrayIndex = -1;
+		location.layer = 0;
+		location.textureID = 0;
+		location.uploadMilliseconds = 0.0f;
+
+		if ((image.levels.empty()) || ((image.channels != 3) && (image.channels != 4)))
+		{
+			continue;
+		}
+
+		int arrayIndex = FindArray(image);
+		if ((arrayIndex < 0) && ((int)m_arrays.size() < MAX_TEXTURE_ARRAYS))
+		{
+			ARRAY_TEXTURE array;
+			array.textureID = 0;
+			array.width = image.width;
+			array.height = image.height;
+			array.levelCount = (int)image.levels.size();
+			array.channels = image.channels;
+			array.format = image.format;
+			array.layerCount = 0;
+			m_arrays.push_back(array);
+			arrayIndex = (int)m_arrays.size() - 1;
+		}
+		if (arrayIndex < 0)
+		{
+			std::cout << "No texture array left for " << image.tag << std::endl;
+			continue;
+		}
+
+		location.arrayIndex = arrayIndex;
+		location.layer = m_arrays[arrayIndex].layerCount++;
+	}
+
+	// allocate the storage of every array at its final size
+	for (ARRAY_TEXTURE& array : m_arrays)
+	{
+		glGenTextures(1, &array.textureID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array.textureID);
+		glTexStorage3D(
+			GL_TEXTURE_2D_ARRAY,
+			array.levelCount,
+			GetInternalFormat(array.channels, array.format),
+			array.width,
+			array.height,
+			array.layerCount);
+
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// set texture filtering parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		std::cout << "Texture array " << array.width << "x" << array.height
+			<< ", layers:" << array.layerCount << ", levels:" << array.levelCount << std::endl;
+	}
+
+	// upload every image into its layer, and view the layer
+	// as a plain 2D texture
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		TEXTURE_LOCATION& location = locations[i];
+		if (location.arrayIndex < 0)
+		{
+			continue;
+		}
+
+		const TextureLoader::DECODED_IMAGE& image = images[i];
+		const ARRAY_TEXTURE& array = m_arrays[location.arrayIndex];
+		GLenum internalFormat = GetInternalFormat(array.channels, array.format);
+		GLenum pixelFormat = (array.channels == 4) ? GL_RGBA : GL_RGB;
+
+		auto uploadStart = std::chrono::high_resolution_clock::now();
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array.textureID);
+		for (int level = 0; level < array.levelCount; level++)
+		{
+			const TextureCache::MIP_LEVEL& mipLevel = image.levels[level];
+			if (array.format != TextureCache::FORMAT_UNCOMPRESSED)
+			{
+				glCompressedTexSubImage3D(
+					GL_TEXTURE_2D_ARRAY, level,
+					0, 0, location.layer,
+					mipLevel.width, mipLevel.height, 1,
+					internalFormat, (GLsizei)mipLevel.size, mipLevel.pixels);
+			}
+			else
+			{
+				glTexSubImage3D(
+					GL_TEXTURE_2D_ARRAY, level,
+					0, 0, location.layer,
+					mipLevel.width, mipLevel.height, 1,
+					pixelFormat, GL_UNSIGNED_BYTE, mipLevel.pixels);
+			}
+		}
+
+		glGenTextures(1, &location.textureID);
+		glTextureView(location.textureID, GL_TEXTURE_2D, array.textureID, internalFormat, 0, array.levelCount, location.layer, 1);
+		glBindTexture(GL_TEXTURE_2D, location.textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		auto uploadEnd = std::chrono::high_resolution_clock::now();
+		location.uploadMilliseconds = std::chrono::duration<float, std::milli>(uploadEnd - uploadStart).count();
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the array textures to
+ *  consecutive texture units.  They stay bound for the
+ *  whole run, so no draw has to rebind them.
+ ***********************************************************/
+void TextureArrayManager::Bind(UniformCache* pUniformCache, int firstTextureUnit)
+{
+	for (int i = 0; i < (int)m_arrays.size(); i++)
+	{
+		if (NULL != pUniformCache)
+		{
+			pUniformCache->BindTexture(firstTextureUnit + i, GL_TEXTURE_2D_ARRAY, m_arrays[i].textureID);
+		}
+		else
+		{
+			glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[i].textureID);
+		}
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the array textures.
+ ***********************************************************/
+void TextureArrayManager::Destroy()
+{
+	for (ARRAY_TEXTURE& array : m_arrays)
+	{
+		if (0 != array.textureID)
+		{
+			glDeleteTextures(1, &array.textureID);
+			array.textureID = 0;
+		}
+	}
+	m_arrays.clear();
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearraymanager.h
+// ============
+// pack the scene textures into layers of 2D array textures
+//
+//  Textures with the same size, format and mip count share one immutable
+//  GL_TEXTURE_2D_ARRAY, one layer each, so a handful of array textures bound
+//  once cover every texture in the scene and a draw selects its texture by
+//  array and layer index instead of rebinding.  Every layer also gets a
+//  GL_TEXTURE_2D view, so shaders using a plain sampler2D can still sample a
+//  single texture without a copy of its pixels.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureLoader.h"
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureArrayManager
+ *
+ *  This class contains the array textures built from the
+ *  decoded scene textures and the layer of each texture.
+ ***********************************************************/
+class TextureArrayManager
+{
+public:
+	// constructor
+	TextureArrayManager();
+	// destructor
+	~TextureArrayManager();
+
+	// array textures a shader can sample from at once
+	static const int MAX_TEXTURE_ARRAYS = 8;
+	// stride of the array index when an array and layer are
+	// packed into one value, arrayIndex * stride + layer
+	static const int MAX_ARRAY_LAYERS = 2048;
+
+	// where a texture was placed, arrayIndex is -1 when the
+	// texture could not be placed in an array
+	struct TEXTURE_LOCATION
+	{
+		int arrayIndex;
+		int layer;
+		// GL_TEXTURE_2D texture sampling just this image, a
+		// view of the array layer
+		GLuint textureID;
+		float uploadMilliseconds;
+	};
+
+	// true when immutable storage and texture views are available
+	static bool IsSupported();
+
+	// build the array textures for the decoded images, one
+	// location per image in the same order
+	void Build(
+		const std::vector<TextureLoader::DECODED_IMAGE>& images,
+		std::vector<TEXTURE_LOCATION>& locations);
+	// bind every array texture to consecutive texture units
+	void Bind(UniformCache* pUniformCache, int firstTextureUnit);
+	// delete the array textures, the views are owned by the caller
+	void Destroy();
+
+	int GetArrayCount() const { return (int)m_arrays.size(); }
+
+private:
+	struct ARRAY_TEXTURE
+	{
+		GLuint textureID;
+		int width;
+		int height;
+		int levelCount;
+		int channels;
+		TextureCache::PIXEL_FORMAT format;
+		int layerCount;
+	};
+
+	// array textures, in the order their first texture loaded
+	std::vector<ARRAY_TEXTURE> m_arrays;
+	// layers one array can hold on this driver
+	int m_maxLayers;
+
+	// find the array an image belongs in, -1 when none matches
+	int FindArray(const TextureLoader::DECODED_IMAGE& image) const;
+	// GL internal format of an image
+	static GLenum GetInternalFormat(int channels, TextureCache::PIXEL_FORMAT format);
+};
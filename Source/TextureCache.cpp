@@ -0,0 +1,376 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// binary cache of decoded textures with prebuilt mip chains
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char CACHE_MAGIC[4] = { 'T', 'X', 'C', 'H' };
+	const uint32_t CACHE_VERSION = 2;
+	const char* const CACHE_EXTENSION = ".texcache";
+	const char* const COMPRESSED_CACHE_EXTENSION = ".bcn.texcache";
+	// level pixels start on this alignment within the file
+	const size_t LEVEL_ALIGNMENT = 16;
+	// more levels than a 2^31 texel image can have
+	const uint32_t MAX_CACHE_LEVELS = 32;
+
+	/***********************************************************
+	 *  AlignOffset()
+	 *
+	 *  Rounds a file offset up to the level alignment.
+	 ***********************************************************/
+	size_t AlignOffset(size_t offset)
+	{
+		return((offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1));
+	}
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for naming the cache file of a
+ *  source image, stored beside it.  Compressed and
+ *  uncompressed levels are kept in separate files so
+ *  switching between them does not rebuild either.
+ ***********************************************************/
+std::string TextureCache::GetCachePath(const char* sourceFilename, bool bCompressed)
+{
+	return(std::string(sourceFilename) + (bCompressed ? COMPRESSED_CACHE_EXTENSION : CACHE_EXTENSION));
+}
+
+/***********************************************************
+ *  GetSourceKey()
+ *
+ *  This method is used for hashing the mapped contents of
+ *  a source image with 64 bit FNV-1a.  Hashing the small
+ *  compressed file is far cheaper than decoding it.
+ ***********************************************************/
+bool TextureCache::GetSourceKey(const char* sourceFilename, SOURCE_KEY& key)
+{
+	MappedFile sourceFile;
+	if (!sourceFile.Open(sourceFilename))
+	{
+		return(false);
+	}
+
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char* pData = sourceFile.GetData();
+	for (size_t i = 0; i < sourceFile.GetSize(); i++)
+	{
+		hash ^= pData[i];
+		hash *= 1099511628211ULL;
+	}
+
+	key.hash = hash;
+	key.size = (uint64_t)sourceFile.GetSize();
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildMipChain()
+ *
+ *  This method is used for building every mip level of an
+ *  image down to 1x1.  Each level averages 2x2 blocks of
+ *  the level above, repeating the last row or column of
+ *  odd sized levels.
+ ***********************************************************/
+unsigned char* TextureCache::BuildMipChain(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int channels,
+	std::vector<MIP_LEVEL>& levels)
+{
+	levels.clear();
+
+	// size every level first so the chain is one allocation
+	size_t totalSize = 0;
+	int levelWidth = width;
+	int levelHeight = height;
+	while (true)
+	{
+		MIP_LEVEL level;
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.pixels = NULL;
+		level.size = (size_t)levelWidth * levelHeight * channels;
+		levels.push_back(level);
+		totalSize += level.size;
+
+		if ((levelWidth == 1) && (levelHeight == 1))
+		{
+			break;
+		}
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+	}
+
+	unsigned char* chain = new unsigned char[totalSize];
+	unsigned char* pLevel = chain;
+	for (MIP_LEVEL& level : levels)
+	{
+		level.pixels = pLevel;
+		pLevel += level.size;
+	}
+	memcpy(chain, pixels, levels[0].size);
+
+	for (size_t i = 1; i < levels.size(); i++)
+	{
+		const MIP_LEVEL& source = levels[i - 1];
+		MIP_LEVEL& target = levels[i];
+		unsigned char* pTarget = (unsigned char*)target.pixels;
+		int sourceRowSize = source.width * channels;
+
+		for (int y = 0; y < target.height; y++)
+		{
+			int y0 = std::min(y * 2, source.height - 1);
+			int y1 = std::min(y * 2 + 1, source.height - 1);
+			const unsigned char* pRow0 = source.pixels + (size_t)y0 * sourceRowSize;
+			const unsigned char* pRow1 = source.pixels + (size_t)y1 * sourceRowSize;
+
+			for (int x = 0; x < target.width; x++)
+			{
+				int x0 = std::min(x * 2, source.width - 1) * channels;
+				int x1 = std::min(x * 2 + 1, source.width - 1) * channels;
+				for (int c = 0; c < channels; c++)
+				{
+					int sum = pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c];
+					*pTarget++ = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	return(chain);
+}
+
+/***********************************************************
+ *  CompressMipChain()
+ *
+ *  This method is used for block compressing every level
+ *  of a mip chain.  RGB images are stored as BC1 and RGBA
+ *  images as BC3, for a 6:1 and 4:1 reduction in size.
+ ***********************************************************/
+unsigned char* TextureCache::CompressMipChain(
+	const std::vector<MIP_LEVEL>& levels,
+	int channels,
+	PIXEL_FORMAT& format,
+	std::vector<MIP_LEVEL>& compressedLevels)
+{
+	format = (channels == 4) ? FORMAT_BC3 : FORMAT_BC1;
+	BlockCompressor::BLOCK_FORMAT blockFormat =
+		(format == FORMAT_BC3) ? BlockCompressor::BLOCK_BC3 : BlockCompressor::BLOCK_BC1;
+
+	compressedLevels = levels;
+	size_t totalSize = 0;
+	for (MIP_LEVEL& level : compressedLevels)
+	{
+		level.size = GetLevelSize(level.width, level.height, channels, format);
+		totalSize += level.size;
+	}
+
+	unsigned char* chain = new unsigned char[totalSize];
+	unsigned char* pLevel = chain;
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		BlockCompressor::CompressImage(
+			levels[i].pixels,
+			levels[i].width,
+			levels[i].height,
+			channels,
+			blockFormat,
+			pLevel);
+		compressedLevels[i].pixels = pLevel;
+		pLevel += compressedLevels[i].size;
+	}
+
+	return(chain);
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  This method is used for sizing one mip level.
+ ***********************************************************/
+size_t TextureCache::GetLevelSize(int width, int height, int channels, PIXEL_FORMAT format)
+{
+	switch (format)
+	{
+	case FORMAT_BC1:
+		return(BlockCompressor::GetCompressedSize(width, height, BlockCompressor::BLOCK_BC1));
+	case FORMAT_BC3:
+		return(BlockCompressor::GetCompressedSize(width, height, BlockCompressor::BLOCK_BC3));
+	default:
+		break;
+	}
+
+	return((size_t)width * height * channels);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing the mip chain of an
+ *  image to its cache file.  The file is written under a
+ *  temporary name and renamed, so an interrupted write
+ *  never leaves a damaged cache behind.
+ ***********************************************************/
+bool TextureCache::Write(
+	const std::string& cachePath,
+	const SOURCE_KEY& key,
+	int channels,
+	PIXEL_FORMAT format,
+	const std::vector<MIP_LEVEL>& levels)
+{
+	if ((levels.empty()) || (levels.size() > MAX_CACHE_LEVELS))
+	{
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.version = CACHE_VERSION;
+	header.sourceHash = key.hash;
+	header.sourceSize = key.size;
+	header.channels = (uint32_t)channels;
+	header.levelCount = (uint32_t)levels.size();
+	header.format = (uint32_t)format;
+	header.reserved = 0;
+
+	std::vector<CACHE_LEVEL> levelTable(levels.size());
+	size_t offset = sizeof(CACHE_HEADER) + levelTable.size() * sizeof(CACHE_LEVEL);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		offset = AlignOffset(offset);
+		levelTable[i].width = (uint32_t)levels[i].width;
+		levelTable[i].height = (uint32_t)levels[i].height;
+		levelTable[i].offset = offset;
+		levelTable[i].size = levels[i].size;
+		offset += levels[i].size;
+	}
+
+	std::string temporaryPath = cachePath + ".tmp";
+	std::ofstream cacheFile(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!cacheFile.is_open())
+	{
+		return(false);
+	}
+
+	cacheFile.write((const char*)&header, sizeof(header));
+	cacheFile.write((const char*)levelTable.data(), levelTable.size() * sizeof(CACHE_LEVEL));
+	const char padding[LEVEL_ALIGNMENT] = { 0 };
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		size_t position = (size_t)cacheFile.tellp();
+		cacheFile.write(padding, (std::streamsize)(levelTable[i].offset - position));
+		cacheFile.write((const char*)levels[i].pixels, (std::streamsize)levels[i].size);
+	}
+	cacheFile.close();
+
+	if (cacheFile.fail())
+	{
+		std::remove(temporaryPath.c_str());
+		return(false);
+	}
+
+	// rename does not replace an existing file on every platform
+	std::remove(cachePath.c_str());
+	if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::remove(temporaryPath.c_str());
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method is used for mapping a cache file and
+ *  pointing the mip levels into the mapping.  The mapping
+ *  must stay open while the levels are in use.
+ ***********************************************************/
+bool TextureCache::Read(
+	const std::string& cachePath,
+	const SOURCE_KEY& key,
+	MappedFile& cacheFile,
+	int& channels,
+	PIXEL_FORMAT& format,
+	std::vector<MIP_LEVEL>& levels)
+{
+	levels.clear();
+	if (!cacheFile.Open(cachePath.c_str()))
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = cacheFile.GetData();
+	size_t fileSize = cacheFile.GetSize();
+
+	CACHE_HEADER header;
+	if (fileSize < sizeof(header))
+	{
+		cacheFile.Close();
+		return(false);
+	}
+	memcpy(&header, pData, sizeof(header));
+
+	// reject other formats, stale caches and damaged headers
+	if ((memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0) ||
+		(header.version != CACHE_VERSION) ||
+		(header.sourceHash != key.hash) ||
+		(header.sourceSize != key.size) ||
+		((header.channels != 3) && (header.channels != 4)) ||
+		(header.levelCount == 0) ||
+		(header.levelCount > MAX_CACHE_LEVELS) ||
+		(header.format > FORMAT_BC3) ||
+		(fileSize < sizeof(header) + header.levelCount * sizeof(CACHE_LEVEL)))
+	{
+		cacheFile.Close();
+		return(false);
+	}
+
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		CACHE_LEVEL levelEntry;
+		memcpy(&levelEntry, pData + sizeof(header) + i * sizeof(CACHE_LEVEL), sizeof(levelEntry));
+
+		uint64_t expectedSize = GetLevelSize(
+			(int)levelEntry.width,
+			(int)levelEntry.height,
+			(int)header.channels,
+			(PIXEL_FORMAT)header.format);
+		if ((levelEntry.size != expectedSize) ||
+			(levelEntry.offset > fileSize) ||
+			(levelEntry.size > fileSize - levelEntry.offset))
+		{
+			levels.clear();
+			cacheFile.Close();
+			return(false);
+		}
+
+		MIP_LEVEL level;
+		level.width = (int)levelEntry.width;
+		level.height = (int)levelEntry.height;
+		level.pixels = pData + levelEntry.offset;
+		level.size = (size_t)levelEntry.size;
+		levels.push_back(level);
+	}
+
+	channels = (int)header.channels;
+	format = (PIXEL_FORMAT)header.format;
+
+	return(true);
+}
@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// binary cache of decoded textures with prebuilt mip chains
+//
+//  A cache file is written next to each source image the first time it is
+//  decoded.  It holds the decoded pixels of every mip level, and is keyed by
+//  a hash of the source file, so editing an image invalidates its cache.
+//  On later runs the cache file is memory mapped and the levels are
+//  uploaded straight from the mapping, without decoding the image or
+//  generating its mipmaps again.  The levels can be stored uncompressed or
+//  block compressed, each in its own cache file.
+//
+//  Cache layout, native byte order:
+//    CACHE_HEADER, levelCount * CACHE_LEVEL, level pixels at their offsets
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class contains the methods for building mip chains
+ *  and for writing and mapping texture cache files.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	// how the pixels of the levels are stored
+	enum PIXEL_FORMAT
+	{
+		// tightly packed RGB or RGBA rows
+		FORMAT_UNCOMPRESSED = 0,
+		// BC1 blocks of an RGB image
+		FORMAT_BC1,
+		// BC3 blocks of an RGBA image
+		FORMAT_BC3
+	};
+
+	// pixels of one mip level
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		const unsigned char* pixels;
+		size_t size;
+	};
+
+	// key identifying the contents of a source image file
+	struct SOURCE_KEY
+	{
+		uint64_t hash;
+		uint64_t size;
+	};
+
+	// path of the cache file kept for a source image file
+	static std::string GetCachePath(const char* sourceFilename, bool bCompressed);
+	// hash the contents of a source image file
+	static bool GetSourceKey(const char* sourceFilename, SOURCE_KEY& key);
+
+	// build the full mip chain of an image into one new[]
+	// allocated buffer, the caller owns the returned buffer
+	static unsigned char* BuildMipChain(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int channels,
+		std::vector<MIP_LEVEL>& levels);
+	// block compress every level of a mip chain into one new[]
+	// allocated buffer, BC1 for RGB and BC3 for RGBA images
+	static unsigned char* CompressMipChain(
+		const std::vector<MIP_LEVEL>& levels,
+		int channels,
+		PIXEL_FORMAT& format,
+		std::vector<MIP_LEVEL>& compressedLevels);
+	// number of bytes of one level in a pixel format
+	static size_t GetLevelSize(int width, int height, int channels, PIXEL_FORMAT format);
+
+	// write the mip chain of an image to a cache file
+	static bool Write(
+		const std::string& cachePath,
+		const SOURCE_KEY& key,
+		int channels,
+		PIXEL_FORMAT format,
+		const std::vector<MIP_LEVEL>& levels);
+	// map a cache file and point the levels into the mapping,
+	// fails when the file is missing, damaged or out of date
+	static bool Read(
+		const std::string& cachePath,
+		const SOURCE_KEY& key,
+		MappedFile& cacheFile,
+		int& channels,
+		PIXEL_FORMAT& format,
+		std::vector<MIP_LEVEL>& levels);
+
+private:
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		uint32_t channels;
+		uint32_t levelCount;
+		uint32_t format;
+		uint32_t reserved;
+	};
+
+	struct CACHE_LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+};
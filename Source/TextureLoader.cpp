@@ -0,0 +1,282 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture image files on worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+#include "TraceRecorder.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_nextRequest = 0;
+	m_deliveredCount = 0;
+	m_bUseCache = true;
+	m_bCompress = false;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  AddRequest()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded once the loader is started.
+ ***********************************************************/
+void TextureLoader::AddRequest(const char* filename, const std::string& tag)
+{
+	REQUEST request;
+	request.filename = filename;
+	request.tag = tag;
+	m_requests.push_back(request);
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the decode threads.
+ *  No more threads are started than there are files.
+ ***********************************************************/
+void TextureLoader::Start(int threadCount)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	threadCount = std::min(threadCount, (int)m_requests.size());
+
+	// the flip setting is global in stb_image, so it is set
+	// once before any thread decodes
+	stbi_set_flip_vertically_on_load(true);
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&TextureLoader::DecodeLoop, this));
+	}
+}
+
+/***********************************************************
+ *  WaitForImage()
+ *
+ *  This method is used for taking the next decoded image,
+ *  in the order the decodes finish.  The caller owns the
+ *  pixels and frees them with FreeImage.
+ ***********************************************************/
+bool TextureLoader::WaitForImage(DECODED_IMAGE& image)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_deliveredCount >= (int)m_requests.size())
+	{
+		return(false);
+	}
+
+	m_decodedCondition.wait(lock, [this]() { return !m_decodedImages.empty(); });
+	image = m_decodedImages.front();
+	m_decodedImages.pop_front();
+	m_deliveredCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DecodeLoop()
+ *
+ *  This method is used for decoding queued files on a
+ *  decode thread until none are left.
+ ***********************************************************/
+void TextureLoader::DecodeLoop()
+{
+	TraceRecorder::SetThreadName("TextureLoader");
+	while (true)
+	{
+		int requestIndex = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_nextRequest >= (int)m_requests.size())
+			{
+				return;
+			}
+			requestIndex = m_nextRequest++;
+		}
+
+		const REQUEST& request = m_requests[requestIndex];
+		TraceRecorder::BeginEvent("DecodeImage");
+		DECODED_IMAGE image = DecodeImage(request.filename.c_str(), request.tag, m_bUseCache, m_bCompress);
+		image.requestIndex = requestIndex;
+		TraceRecorder::EndEvent("DecodeImage");
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decodedImages.push_back(image);
+		}
+		m_decodedCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for waiting for the decode threads
+ *  to finish and freeing images that were never taken.
+ ***********************************************************/
+void TextureLoader::Stop()
+{
+	{
+		// skip the files no thread has started on yet
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_nextRequest = (int)m_requests.size();
+	}
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+
+	for (DECODED_IMAGE& image : m_decodedImages)
+	{
+		FreeImage(image);
+	}
+	m_decodedImages.clear();
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for loading every mip level of one
+ *  image file.  An up to date cache file is mapped when
+ *  there is one.  Otherwise the file is decoded with
+ *  stb_image, its mip chain is built and optionally block
+ *  compressed, and the cache file is written for the next
+ *  run.  The time taken is recorded.
+ ***********************************************************/
+TextureLoader::DECODED_IMAGE TextureLoader::DecodeImage(const char* filename, const std::string& tag, bool bUseCache, bool bCompress)
+{
+	DECODED_IMAGE image;
+	image.requestIndex = 0;
+	image.filename = filename;
+	image.tag = tag;
+	image.width = 0;
+	image.height = 0;
+	image.channels = 0;
+	image.pixels = NULL;
+	image.pCacheFile = NULL;
+	image.bFromCache = false;
+	image.format = TextureCache::FORMAT_UNCOMPRESSED;
+
+	auto decodeStart = std::chrono::high_resolution_clock::now();
+
+	TextureCache::SOURCE_KEY sourceKey;
+	bool bKeyed = (bUseCache) && (TextureCache::GetSourceKey(filename, sourceKey));
+	std::string cachePath = TextureCache::GetCachePath(filename, bCompress);
+	if (bKeyed)
+	{
+		image.pCacheFile = new MappedFile();
+		if ((TextureCache::Read(cachePath, sourceKey, *image.pCacheFile, image.channels, image.format, image.levels)) &&
+			(bCompress == (image.format != TextureCache::FORMAT_UNCOMPRESSED)))
+		{
+			image.bFromCache = true;
+		}
+		else
+		{
+			delete image.pCacheFile;
+			image.pCacheFile = NULL;
+			image.levels.clear();
+			image.format = TextureCache::FORMAT_UNCOMPRESSED;
+		}
+	}
+
+	if (!image.bFromCache)
+	{
+		unsigned char* decodedPixels = stbi_load(
+			filename,
+			&image.width,
+			&image.height,
+			&image.channels,
+			0);
+
+		if (NULL != decodedPixels)
+		{
+			image.pixels = TextureCache::BuildMipChain(
+				decodedPixels,
+				image.width,
+				image.height,
+				image.channels,
+				image.levels);
+			stbi_image_free(decodedPixels);
+
+			bool bUploadable = (image.channels == 3) || (image.channels == 4);
+			if ((bCompress) && (bUploadable))
+			{
+				std::vector<TextureCache::MIP_LEVEL> compressedLevels;
+				unsigned char* compressedChain = TextureCache::CompressMipChain(
+					image.levels,
+					image.channels,
+					image.format,
+					compressedLevels);
+				delete[] image.pixels;
+				image.pixels = compressedChain;
+				image.levels.swap(compressedLevels);
+			}
+
+			// only the formats that can be uploaded are cached
+			if ((bKeyed) &&
+				(bUploadable) &&
+				(!TextureCache::Write(cachePath, sourceKey, image.channels, image.format, image.levels)))
+			{
+				std::cout << "Could not write texture cache:" << cachePath << std::endl;
+			}
+		}
+	}
+
+	if (!image.levels.empty())
+	{
+		image.width = image.levels[0].width;
+		image.height = image.levels[0].height;
+	}
+
+	auto decodeEnd = std::chrono::high_resolution_clock::now();
+	image.decodeMilliseconds = std::chrono::duration<float, std::milli>(decodeEnd - decodeStart).count();
+
+	return(image);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for freeing the mip chain or closing
+ *  the cache mapping of a decoded image.
+ ***********************************************************/
+void TextureLoader::FreeImage(DECODED_IMAGE& image)
+{
+	if (NULL != image.pixels)
+	{
+		delete[] image.pixels;
+		image.pixels = NULL;
+	}
+	if (NULL != image.pCacheFile)
+	{
+		delete image.pCacheFile;
+		image.pCacheFile = NULL;
+	}
+	image.levels.clear();
+}
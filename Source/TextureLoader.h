@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture image files on worker threads
+//
+//  Image files are queued by the thread that owns the GL context, decoded
+//  in parallel on worker threads, and handed back one at a time as each
+//  decode finishes so the owning thread can upload it while the remaining
+//  files are still decoding.  Files with an up to date texture cache are
+//  mapped instead of decoded.  The loader itself never calls OpenGL.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class contains the queued image files, the decode
+ *  threads and the images waiting to be uploaded.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// pixels of one decoded image file
+	struct DECODED_IMAGE
+	{
+		// position of the file in the request order
+		int requestIndex;
+		std::string filename;
+		std::string tag;
+		// every mip level of the image, empty when the file
+		// could not be decoded
+		std::vector<TextureCache::MIP_LEVEL> levels;
+		int width;
+		int height;
+		int channels;
+		// storage the levels point into, either a decoded or
+		// compressed mip chain, or a mapped cache file
+		unsigned char* pixels;
+		MappedFile* pCacheFile;
+		// how the pixels of the levels are stored
+		TextureCache::PIXEL_FORMAT format;
+		// true when the levels came from the texture cache
+		bool bFromCache;
+		float decodeMilliseconds;
+	};
+
+	// queue an image file to decode, before Start
+	void AddRequest(const char* filename, const std::string& tag);
+	// read and write the texture cache, enabled by default
+	void SetCacheEnabled(bool bUseCache) { m_bUseCache = bUseCache; }
+	// block compress the mip levels, disabled by default
+	void SetCompression(bool bCompress) { m_bCompress = bCompress; }
+	// start decoding the queued files on a number of threads,
+	// 0 picks one thread per core
+	void Start(int threadCount);
+	// wait for the next decoded image, returns false once every
+	// queued file has been handed out
+	bool WaitForImage(DECODED_IMAGE& image);
+
+	// decode an image file and build its mip chain on the calling
+	// thread, through the texture cache when it is used
+	static DECODED_IMAGE DecodeImage(const char* filename, const std::string& tag, bool bUseCache, bool bCompress);
+	// free the pixels or cache mapping of a decoded image
+	static void FreeImage(DECODED_IMAGE& image);
+
+	int GetRequestCount() const { return (int)m_requests.size(); }
+
+private:
+	struct REQUEST
+	{
+		std::string filename;
+		std::string tag;
+	};
+
+	// queued image files
+	std::vector<REQUEST> m_requests;
+	// decode threads
+	std::vector<std::thread> m_threads;
+	// guards the fields below
+	std::mutex m_mutex;
+	std::condition_variable m_decodedCondition;
+	// next request for a decode thread to take
+	int m_nextRequest;
+	// decoded images waiting to be handed out
+	std::deque<DECODED_IMAGE> m_decodedImages;
+	// images handed out by WaitForImage
+	int m_deliveredCount;
+	bool m_bUseCache;
+	bool m_bCompress;
+
+	// main function of a decode thread
+	void DecodeLoop();
+	// join the decode threads and free undelivered images
+	void Stop();
+};
@@ -0,0 +1,344 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidencymanager.cpp
+// ============
+// decide which mip levels of the scene textures are kept in video memory
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidencyManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// levels no larger than this are always resident, so every
+	// texture can be sampled before its finer levels stream in
+	const int MIN_RESIDENT_SIZE = 64;
+	// textures recreated with finer levels per frame, to bound
+	// the upload time of a single frame
+	const int MAX_STREAM_UPLOADS_PER_FRAME = 2;
+}
+
+/***********************************************************
+ *  TextureResidencyManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidencyManager::TextureResidencyManager()
+{
+	m_budgetBytes = 0;
+	m_residentBytes = 0;
+	m_frame = 0;
+	m_streamedCount = 0;
+	m_evictedCount = 0;
+}
+
+/***********************************************************
+ *  ~TextureResidencyManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureResidencyManager::~TextureResidencyManager()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  GetTailLevel()
+ *
+ *  This method is used for getting the first level of an
+ *  image that is small enough to always keep resident.
+ ***********************************************************/
+int TextureResidencyManager::GetTailLevel(const TextureLoader::DECODED_IMAGE& image)
+{
+	for (int level = 0; level < (int)image.levels.size(); level++)
+	{
+		if (std::max(image.levels[level].width, image.levels[level].height) <= MIN_RESIDENT_SIZE)
+		{
+			return(level);
+		}
+	}
+
+	return(std::max((int)image.levels.size() - 1, 0));
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for taking ownership of the decoded
+ *  image of a texture slot.  Only the coarse tail of its
+ *  mip chain starts out resident.
+ ***********************************************************/
+void TextureResidencyManager::AddTexture(int textureSlot, const TextureLoader::DECODED_IMAGE& image)
+{
+	// slots in between, if any, stay inactive
+	for (int i = (int)m_textures.size(); i <= textureSlot; i++)
+	{
+		TEXTURE_STATE texture;
+		texture.image.requestIndex = 0;
+		texture.image.width = 0;
+		texture.image.height = 0;
+		texture.image.channels = 0;
+		texture.image.pixels = NULL;
+		texture.image.pCacheFile = NULL;
+		texture.image.format = TextureCache::FORMAT_UNCOMPRESSED;
+		texture.image.bFromCache = false;
+		texture.image.decodeMilliseconds = 0.0f;
+		texture.minimumLevel = 0;
+		texture.residentLevel = 0;
+		texture.requestedLevel = 0;
+		texture.lastUsedFrame = 0;
+		texture.bActive = false;
+		m_textures.push_back(texture);
+	}
+
+	TEXTURE_STATE& texture = m_textures[textureSlot];
+	texture.image = image;
+	texture.bActive = !image.levels.empty();
+	texture.lastUsedFrame = m_frame;
+	texture.minimumLevel = 0;
+	texture.residentLevel = 0;
+	if (!texture.bActive)
+	{
+		return;
+	}
+
+	int levelCount = (int)image.levels.size();
+	texture.chainBytes.assign(levelCount, 0);
+	size_t chainBytes = 0;
+	for (int level = levelCount - 1; level >= 0; level--)
+	{
+		chainBytes += image.levels[level].size;
+		texture.chainBytes[level] = chainBytes;
+	}
+
+	texture.minimumLevel = GetTailLevel(image);
+	texture.residentLevel = texture.minimumLevel;
+	texture.requestedLevel = levelCount;
+	m_residentBytes += texture.chainBytes[texture.residentLevel];
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing the decoded image of
+ *  every texture.
+ ***********************************************************/
+void TextureResidencyManager::Clear()
+{
+	for (TEXTURE_STATE& texture : m_textures)
+	{
+		TextureLoader::FreeImage(texture.image);
+	}
+	m_textures.clear();
+	m_residentBytes = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for forgetting the level requests
+ *  of the previous frame.
+ ***********************************************************/
+void TextureResidencyManager::BeginFrame()
+{
+	m_frame++;
+	m_streamedCount = 0;
+	m_evictedCount = 0;
+	for (TEXTURE_STATE& texture : m_textures)
+	{
+		texture.requestedLevel = (int)texture.chainBytes.size();
+	}
+}
+
+/***********************************************************
+ *  RequestLevel()
+ *
+ *  This method is used for asking for a level of a texture
+ *  this frame.  The finest level asked for wins, and the
+ *  texture counts as used for the eviction order.
+ ***********************************************************/
+void TextureResidencyManager::RequestLevel(int textureSlot, int level)
+{
+	if ((textureSlot < 0) ||
+		(textureSlot >= (int)m_textures.size()) ||
+		(!m_textures[textureSlot].bActive))
+	{
+		return;
+	}
+
+	TEXTURE_STATE& texture = m_textures[textureSlot];
+	texture.requestedLevel = std::min(texture.requestedLevel, std::max(level, 0));
+	texture.lastUsedFrame = m_frame;
+}
+
+/***********************************************************
+ *  GetLevelForCoverage()
+ *
+ *  This method is used for getting the coarsest level that
+ *  still has a texel for every screen pixel, when the
+ *  texture is repeated the passed in number of times across
+ *  an object covering the passed in screen pixels.
+ ***********************************************************/
+int TextureResidencyManager::GetLevelForCoverage(int textureSlot, float repeatCount, float screenPixels) const
+{
+	if ((textureSlot < 0) ||
+		(textureSlot >= (int)m_textures.size()) ||
+		(!m_textures[textureSlot].bActive))
+	{
+		return(0);
+	}
+
+	const TEXTURE_STATE& texture = m_textures[textureSlot];
+	int levelCount = (int)texture.chainBytes.size();
+	if (screenPixels < 1.0f)
+	{
+		return(levelCount - 1);
+	}
+
+	float texelsAcross = (float)std::max(texture.image.width, texture.image.height) * std::max(repeatCount, 1.0f);
+	float texelsPerPixel = texelsAcross / screenPixels;
+	if (texelsPerPixel <= 1.0f)
+	{
+		return(0);
+	}
+
+	return(std::min((int)std::floor(std::log2(texelsPerPixel)), levelCount - 1));
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for choosing the residency changes
+ *  of this frame.  The textures furthest from the level
+ *  they were asked for are streamed first, each straight to
+ *  the finest level the budget makes room for.  Room is
+ *  made by trimming textures to the level they were asked
+ *  for, least recently used first.
+ ***********************************************************/
+void TextureResidencyManager::Update(std::vector<RESIDENCY_CHANGE>& changes)
+{
+	changes.clear();
+	if (!IsStreaming())
+	{
+		return;
+	}
+
+	std::vector<int> candidates;
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		if ((m_textures[i].bActive) && (m_textures[i].requestedLevel < m_textures[i].residentLevel))
+		{
+			candidates.push_back(i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](int a, int b)
+	{
+		int missingA = m_textures[a].residentLevel - m_textures[a].requestedLevel;
+		int missingB = m_textures[b].residentLevel - m_textures[b].requestedLevel;
+		return (missingA != missingB) ? (missingA > missingB) : (a < b);
+	});
+
+	int uploadCount = 0;
+	for (int textureSlot : candidates)
+	{
+		if (uploadCount >= MAX_STREAM_UPLOADS_PER_FRAME)
+		{
+			break;
+		}
+
+		TEXTURE_STATE& texture = m_textures[textureSlot];
+		for (int level = texture.requestedLevel; level < texture.residentLevel; level++)
+		{
+			size_t neededBytes = texture.chainBytes[level] - texture.chainBytes[texture.residentLevel];
+			if (MakeRoom(neededBytes, changes))
+			{
+				SetResidentLevel(textureSlot, level, changes);
+				m_streamedCount++;
+				uploadCount++;
+				break;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  MakeRoom()
+ *
+ *  This method is used for trimming textures until the
+ *  passed in bytes fit in the budget.  A texture is only
+ *  trimmed down to the level it was asked for this frame,
+ *  or to its tail when it was not used, so a visible
+ *  texture never loses detail it needs.  Nothing is trimmed
+ *  when the bytes would not fit anyway.
+ ***********************************************************/
+bool TextureResidencyManager::MakeRoom(size_t neededBytes, std::vector<RESIDENCY_CHANGE>& changes)
+{
+	if (m_residentBytes + neededBytes <= m_budgetBytes)
+	{
+		return(true);
+	}
+
+	std::vector<int> victims;
+	size_t reclaimableBytes = 0;
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		const TEXTURE_STATE& texture = m_textures[i];
+		if (!texture.bActive)
+		{
+			continue;
+		}
+		int targetLevel = std::min(texture.requestedLevel, texture.minimumLevel);
+		if (texture.residentLevel < targetLevel)
+		{
+			victims.push_back(i);
+			reclaimableBytes += texture.chainBytes[texture.residentLevel] - texture.chainBytes[targetLevel];
+		}
+	}
+	if (m_residentBytes - reclaimableBytes + neededBytes > m_budgetBytes)
+	{
+		return(false);
+	}
+
+	// least recently used first
+	std::sort(victims.begin(), victims.end(), [this](int a, int b)
+	{
+		return (m_textures[a].lastUsedFrame != m_textures[b].lastUsedFrame) ?
+			(m_textures[a].lastUsedFrame < m_textures[b].lastUsedFrame) : (a < b);
+	});
+
+	for (int textureSlot : victims)
+	{
+		if (m_residentBytes + neededBytes <= m_budgetBytes)
+		{
+			break;
+		}
+
+		const TEXTURE_STATE& texture = m_textures[textureSlot];
+		SetResidentLevel(textureSlot, std::min(texture.requestedLevel, texture.minimumLevel), changes);
+		m_evictedCount++;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetResidentLevel()
+ *
+ *  This method is used for moving a texture to a new
+ *  finest resident level and recording the change for the
+ *  caller to apply.
+ ***********************************************************/
+void TextureResidencyManager::SetResidentLevel(int textureSlot, int firstLevel, std::vector<RESIDENCY_CHANGE>& changes)
+{
+	TEXTURE_STATE& texture = m_textures[textureSlot];
+	m_residentBytes -= texture.chainBytes[texture.residentLevel];
+	m_residentBytes += texture.chainBytes[firstLevel];
+	texture.residentLevel = firstLevel;
+
+	RESIDENCY_CHANGE change;
+	change.textureSlot = textureSlot;
+	change.firstLevel = firstLevel;
+	changes.push_back(change);
+}
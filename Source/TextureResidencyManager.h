@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidencymanager.h
+// ============
+// decide which mip levels of the scene textures are kept in video memory
+//
+//  Every streamed texture keeps its decoded mip chain on the CPU, usually as
+//  a mapped texture cache file, and only its coarse tail is uploaded when it
+//  is loaded.  Each frame the scene requests the finest level every visible
+//  texture needs for its size on screen, and the manager picks the textures
+//  to stream finer levels into and the least recently used ones to trim so
+//  the resident levels stay within the memory budget.  The manager issues
+//  no GL calls; the caller recreates the textures it reports as changed.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureLoader.h"
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  TextureResidencyManager
+ *
+ *  This class contains the residency state of the streamed
+ *  textures, indexed by texture slot, and the budget they
+ *  share.
+ ***********************************************************/
+class TextureResidencyManager
+{
+public:
+	// constructor
+	TextureResidencyManager();
+	// destructor
+	~TextureResidencyManager();
+
+	// a texture whose finest resident level has to change
+	struct RESIDENCY_CHANGE
+	{
+		int textureSlot;
+		int firstLevel;
+	};
+
+	// set the video memory budget of the streamed textures,
+	// 0 disables streaming
+	void SetBudget(size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+	bool IsStreaming() const { return (m_budgetBytes > 0); }
+
+	// first level of the coarse tail of an image, which is
+	// uploaded when the texture is loaded and always resident
+	static int GetTailLevel(const TextureLoader::DECODED_IMAGE& image);
+	// take ownership of the decoded image of a texture slot
+	// whose tail has been uploaded
+	void AddTexture(int textureSlot, const TextureLoader::DECODED_IMAGE& image);
+	// decoded image of a texture slot
+	const TextureLoader::DECODED_IMAGE& GetImage(int textureSlot) const { return m_textures[textureSlot].image; }
+	// finest level of a texture slot that is in video memory
+	int GetResidentLevel(int textureSlot) const { return m_textures[textureSlot].residentLevel; }
+	// free every decoded image
+	void Clear();
+
+	// start collecting the level requests of a new frame
+	void BeginFrame();
+	// request the passed in level of a texture for this frame
+	void RequestLevel(int textureSlot, int level);
+	// level of a texture repeated the passed in number of times
+	// across an object covering the passed in screen pixels
+	int GetLevelForCoverage(int textureSlot, float repeatCount, float screenPixels) const;
+	// choose the textures to trim and stream this frame, trims
+	// are listed before the uploads they make room for
+	void Update(std::vector<RESIDENCY_CHANGE>& changes);
+
+	// bytes of the resident levels of every texture
+	size_t GetResidentBytes() const { return m_residentBytes; }
+	size_t GetBudgetBytes() const { return m_budgetBytes; }
+	// textures streamed finer and trimmed since BeginFrame
+	int GetStreamedCount() const { return m_streamedCount; }
+	int GetEvictedCount() const { return m_evictedCount; }
+
+private:
+	struct TEXTURE_STATE
+	{
+		TextureLoader::DECODED_IMAGE image;
+		// bytes in video memory when each level is the finest
+		// resident one
+		std::vector<size_t> chainBytes;
+		// coarsest level that is always resident
+		int minimumLevel;
+		int residentLevel;
+		// finest level requested this frame, the level count
+		// when the texture is not used
+		int requestedLevel;
+		unsigned int lastUsedFrame;
+		bool bActive;
+	};
+
+	// textures indexed by slot, inactive slots are not streamed
+	std::vector<TEXTURE_STATE> m_textures;
+	size_t m_budgetBytes;
+	size_t m_residentBytes;
+	unsigned int m_frame;
+	int m_streamedCount;
+	int m_evictedCount;
+
+	// move a texture to a new finest level and record the change
+	void SetResidentLevel(int textureSlot, int firstLevel, std::vector<RESIDENCY_CHANGE>& changes);
+	// trim least recently used textures until the passed in bytes
+	// fit in the budget, false when they cannot
+	bool MakeRoom(size_t neededBytes, std::vector<RESIDENCY_CHANGE>& changes);
+};
@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ============
+// work stealing pool of worker threads for the per-frame update work
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadPool::ThreadPool(int workerCount)
+	: m_queuedTasks(0),
+	m_pendingTasks(0),
+	m_stolenTasks(0),
+	m_bStopping(false)
+{
+	workerCount = std::max(workerCount, 0);
+
+	for (int i = 0; i < workerCount + 1; i++)
+	{
+		m_queues.push_back(std::unique_ptr<TASK_QUEUE>(new TASK_QUEUE()));
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStopping = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  GetDefaultWorkerCount()
+ *
+ *  This method is used for choosing one worker per core,
+ *  leaving a core for the thread that owns the GL context.
+ ***********************************************************/
+int ThreadPool::GetDefaultWorkerCount()
+{
+	int coreCount = (int)std::thread::hardware_concurrency();
+	return(std::max(coreCount - 1, 0));
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a loop body over chunks
+ *  of an index range on the workers and the calling thread.
+ *  The chunks are dealt round robin into the queues, and
+ *  idle threads steal from the busy ones.
+ ***********************************************************/
+void ThreadPool::ParallelFor(int count, int grainSize, const RANGE_FUNCTION& body)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	grainSize = std::max(grainSize, 1);
+
+	// small loops are not worth waking the workers for
+	if ((m_workers.empty()) || (count <= grainSize))
+	{
+		body(0, count);
+		return;
+	}
+
+	int chunkCount = (count + grainSize - 1) / grainSize;
+	m_pendingTasks = chunkCount;
+
+	int queueCount = (int)m_queues.size();
+	for (int chunk = 0; chunk < chunkCount; chunk++)
+	{
+		TASK task;
+		task.pBody = &body;
+		task.begin = chunk * grainSize;
+		task.end = std::min(task.begin + grainSize, count);
+
+		TASK_QUEUE& queue = *m_queues[chunk % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedTasks += chunkCount;
+	}
+	m_wakeCondition.notify_all();
+
+	// the calling thread works until every chunk is done,
+	// including chunks still running on other threads
+	int callerQueue = queueCount - 1;
+	while (m_pendingTasks.load(std::memory_order_acquire) > 0)
+	{
+		if (!RunNextTask(callerQueue))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running tasks on a worker
+ *  thread, sleeping while every queue is empty.
+ ***********************************************************/
+void ThreadPool::WorkerLoop(int queueIndex)
+{
+	TraceRecorder::SetThreadName("Worker");
+	while (true)
+	{
+		if (RunNextTask(queueIndex))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wakeCondition.wait(lock, [this]() { return (m_bStopping) || (m_queuedTasks.load() > 0); });
+		if ((m_bStopping) && (m_queuedTasks.load() == 0))
+		{
+			return;
+		}
+	}
+}
+
+/***********************************************************
+ *  RunNextTask()
+ *
+ *  This method is used for running one task from a thread's
+ *  own queue, or one stolen from another queue.  Returns
+ *  false when no task was found.
+ ***********************************************************/
+bool ThreadPool::RunNextTask(int queueIndex)
+{
+	TASK task;
+	if ((!PopTask(queueIndex, task)) && (!StealTask(queueIndex, task)))
+	{
+		return(false);
+	}
+
+	TraceRecorder::BeginEvent("ParallelTask");
+	(*task.pBody)(task.begin, task.end);
+	TraceRecorder::EndEvent("ParallelTask");
+	m_pendingTasks.fetch_sub(1, std::memory_order_release);
+
+	return(true);
+}
+
+/***********************************************************
+ *  PopTask()
+ *
+ *  This method is used for taking the most recently queued
+ *  task of a thread's own queue.
+ ***********************************************************/
+bool ThreadPool::PopTask(int queueIndex, TASK& task)
+{
+	TASK_QUEUE& queue = *m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+	{
+		return(false);
+	}
+
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+	m_queuedTasks--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StealTask()
+ *
+ *  This method is used for taking the oldest task of the
+ *  first other queue that has one.
+ ***********************************************************/
+bool ThreadPool::StealTask(int queueIndex, TASK& task)
+{
+	if (m_queuedTasks.load() == 0)
+	{
+		return(false);
+	}
+
+	int queueCount = (int)m_queues.size();
+	for (int offset = 1; offset < queueCount; offset++)
+	{
+		TASK_QUEUE& queue = *m_queues[(queueIndex + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			continue;
+		}
+
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+		m_queuedTasks--;
+		m_stolenTasks++;
+
+		return(true);
+	}
+
+	return(false);
+}
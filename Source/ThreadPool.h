@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// work stealing pool of worker threads for the per-frame update work
+//
+//  Every worker owns a queue of tasks.  A worker takes tasks from the back
+//  of its own queue and, when that runs dry, steals from the front of the
+//  other queues, so uneven chunks are balanced across the threads.  The
+//  thread calling ParallelFor works on its own queue alongside the workers
+//  until every chunk is finished.  The pool never touches OpenGL.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  This class contains the worker threads, their task
+ *  queues and the parallel loop used by the scene update.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+	// constructor, 0 workers runs every loop on the calling thread
+	ThreadPool(int workerCount);
+	// destructor
+	~ThreadPool();
+
+	// loop body called with a [begin, end) range of the indices
+	typedef std::function<void(int begin, int end)> RANGE_FUNCTION;
+
+	// split [0, count) into chunks of grainSize indices and run
+	// the body over every chunk, returning when all are done.
+	// Chunks start at multiples of grainSize, so begin / grainSize
+	// is a stable chunk index.  Only one loop may run at a time.
+	void ParallelFor(int count, int grainSize, const RANGE_FUNCTION& body);
+
+	int GetWorkerCount() const { return (int)m_workers.size(); }
+	// number of chunks run by a thread other than their owner
+	int GetStolenCount() const { return m_stolenTasks.load(); }
+
+	// default number of workers for this machine
+	static int GetDefaultWorkerCount();
+
+private:
+	struct TASK
+	{
+		const RANGE_FUNCTION* pBody;
+		int begin;
+		int end;
+	};
+
+	// tasks owned by one thread
+	struct TASK_QUEUE
+	{
+		std::mutex mutex;
+		std::deque<TASK> tasks;
+	};
+
+	std::vector<std::thread> m_workers;
+	// one queue per worker, the last one belongs to the
+	// thread calling ParallelFor
+	std::vector<std::unique_ptr<TASK_QUEUE>> m_queues;
+	// sleeping workers wait here for queued tasks
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	// tasks waiting in any queue
+	std::atomic<int> m_queuedTasks;
+	// tasks of the current loop that have not finished
+	std::atomic<int> m_pendingTasks;
+	std::atomic<int> m_stolenTasks;
+	std::atomic<bool> m_bStopping;
+
+	// main function of a worker thread
+	void WorkerLoop(int queueIndex);
+	// take a task from the back of a thread's own queue
+	bool PopTask(int queueIndex, TASK& task);
+	// take a task from the front of another thread's queue
+	bool StealTask(int queueIndex, TASK& task);
+	// find a task for a thread and run it
+	bool RunNextTask(int queueIndex);
+};
@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////////////////
+// tracerecorder.cpp
+// ============
+// record begin and end events of every thread for a trace viewer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// events kept per thread, the oldest are overwritten first
+	const int EVENTS_PER_THREAD = 16384;
+
+	// event in a thread's ring, its fields are atomic so a trace
+	// can be written while the thread keeps recording
+	struct TRACE_EVENT
+	{
+		std::atomic<const char*> name;
+		// nanoseconds since the recorder started
+		std::atomic<long long> timestamp;
+		// 'B' for begin, 'E' for end
+		std::atomic<char> phase;
+	};
+
+	struct THREAD_BUFFER
+	{
+		int threadID;
+		// guarded by the buffer list mutex
+		std::string threadName;
+		// events recorded so far, the next one goes to this
+		// index modulo the ring size
+		std::atomic<unsigned long long> head;
+		TRACE_EVENT events[EVENTS_PER_THREAD];
+	};
+
+	// event copied out of a ring for writing
+	struct EVENT_COPY
+	{
+		const char* name;
+		long long timestamp;
+		char phase;
+	};
+
+	std::atomic<bool> g_bTraceEnabled(false);
+	const std::chrono::steady_clock::time_point g_traceStart = std::chrono::steady_clock::now();
+
+	// rings of every thread that recorded, kept until exit so
+	// threads that finished still show up in the trace
+	std::mutex g_bufferMutex;
+	std::vector<std::unique_ptr<THREAD_BUFFER>> g_threadBuffers;
+	std::string g_outputPath = "trace.json";
+
+	thread_local THREAD_BUFFER* t_pThreadBuffer = nullptr;
+	thread_local const char* t_threadName = nullptr;
+
+	/***********************************************************
+	 *  GetThreadBuffer()
+	 *
+	 *  This function is used for getting the ring of the
+	 *  calling thread, which is created on its first event.
+	 ***********************************************************/
+	THREAD_BUFFER* GetThreadBuffer()
+	{
+		if (nullptr != t_pThreadBuffer)
+		{
+			return(t_pThreadBuffer);
+		}
+
+		std::unique_ptr<THREAD_BUFFER> pBuffer(new THREAD_BUFFER());
+		pBuffer->head.store(0);
+		std::lock_guard<std::mutex> lock(g_bufferMutex);
+		pBuffer->threadID = (int)g_threadBuffers.size() + 1;
+		pBuffer->threadName = (nullptr != t_threadName) ?
+			std::string(t_threadName) : "Thread " + std::to_string(pBuffer->threadID);
+		t_pThreadBuffer = pBuffer.get();
+		g_threadBuffers.push_back(std::move(pBuffer));
+
+		return(t_pThreadBuffer);
+	}
+}
+
+/***********************************************************
+ *  WriteJSONString()
+ *
+ *  This method is used for writing a quoted JSON string,
+ *  for the trace and the other JSON files the scene writes.
+ ***********************************************************/
+void TraceRecorder::WriteJSONString(std::ostream& output, const std::string& text)
+{
+	output << '"';
+	for (char character : text)
+	{
+		if ((character == '"') || (character == '\\'))
+		{
+			output << '\\';
+		}
+		output << character;
+	}
+	output << '"';
+}
+
+/***********************************************************
+ *  SetEnabled()
+ *
+ *  This method is used for starting or stopping the
+ *  recording of events.
+ ***********************************************************/
+void TraceRecorder::SetEnabled(bool bEnabled)
+{
+	g_bTraceEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  This method is used for checking whether events are
+ *  being recorded.
+ ***********************************************************/
+bool TraceRecorder::IsEnabled()
+{
+	return(g_bTraceEnabled.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  SetOutputPath()
+ *
+ *  This method is used for setting the file the trace is
+ *  written to.
+ ***********************************************************/
+void TraceRecorder::SetOutputPath(const std::string& outputPath)
+{
+	std::lock_guard<std::mutex> lock(g_bufferMutex);
+	g_outputPath = outputPath;
+}
+
+/***********************************************************
+ *  SetThreadName()
+ *
+ *  This method is used for naming the track of the calling
+ *  thread in the trace.  The passed in name must outlive
+ *  the thread.
+ ***********************************************************/
+void TraceRecorder::SetThreadName(const char* name)
+{
+	t_threadName = name;
+	if (nullptr != t_pThreadBuffer)
+	{
+		std::lock_guard<std::mutex> lock(g_bufferMutex);
+		t_pThreadBuffer->threadName = name;
+	}
+}
+
+/***********************************************************
+ *  BeginEvent()
+ *
+ *  This method is used for recording the start of the
+ *  named event on the calling thread.
+ ***********************************************************/
+void TraceRecorder::BeginEvent(const char* name)
+{
+	AddEvent(name, 'B');
+}
+
+/***********************************************************
+ *  EndEvent()
+ *
+ *  This method is used for recording the end of the named
+ *  event on the calling thread.
+ ***********************************************************/
+void TraceRecorder::EndEvent(const char* name)
+{
+	AddEvent(name, 'E');
+}
+
+/***********************************************************
+ *  AddEvent()
+ *
+ *  This method is used for writing an event to the next
+ *  slot of the calling thread's ring.  The head is only
+ *  advanced once the event is written, so a trace being
+ *  written never reads a slot before it is filled.
+ ***********************************************************/
+void TraceRecorder::AddEvent(const char* name, char phase)
+{
+	if (!g_bTraceEnabled.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	THREAD_BUFFER* pBuffer = GetThreadBuffer();
+	unsigned long long head = pBuffer->head.load(std::memory_order_relaxed);
+	TRACE_EVENT& event = pBuffer->events[head % EVENTS_PER_THREAD];
+	event.name.store(name, std::memory_order_relaxed);
+	event.timestamp.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - g_traceStart).count(), std::memory_order_relaxed);
+	event.phase.store(phase, std::memory_order_relaxed);
+	pBuffer->head.store(head + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for writing the recorded events to
+ *  the output path.
+ ***********************************************************/
+bool TraceRecorder::WriteTrace()
+{
+	std::string outputPath;
+	{
+		std::lock_guard<std::mutex> lock(g_bufferMutex);
+		outputPath = g_outputPath;
+	}
+
+	return(WriteTrace(outputPath));
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for writing the events in every
+ *  thread's ring to a Chrome trace_event JSON file.  The
+ *  threads keep recording meanwhile; events overwritten
+ *  while their ring was copied are left out, as are end
+ *  events whose begin event was already overwritten.
+ ***********************************************************/
+bool TraceRecorder::WriteTrace(const std::string& filename)
+{
+	std::ofstream traceFile(filename.c_str());
+	if (!traceFile.is_open())
+	{
+		std::cout << "Could not write trace file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::lock_guard<std::mutex> lock(g_bufferMutex);
+	traceFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+	traceFile << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Scene\"}}";
+
+	int eventCount = 0;
+	std::vector<EVENT_COPY> events;
+	traceFile << std::fixed << std::setprecision(3);
+	for (const std::unique_ptr<THREAD_BUFFER>& pBuffer : g_threadBuffers)
+	{
+		traceFile << "," << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+			<< pBuffer->threadID << ",\"args\":{\"name\":";
+		WriteJSONString(traceFile, pBuffer->threadName);
+		traceFile << "}}";
+
+		unsigned long long head = pBuffer->head.load(std::memory_order_acquire);
+		unsigned long long first = (head > EVENTS_PER_THREAD) ? head - EVENTS_PER_THREAD : 0;
+		events.clear();
+		for (unsigned long long i = first; i < head; i++)
+		{
+			const TRACE_EVENT& event = pBuffer->events[i % EVENTS_PER_THREAD];
+			EVENT_COPY copy;
+			copy.name = event.name.load(std::memory_order_relaxed);
+			copy.timestamp = event.timestamp.load(std::memory_order_relaxed);
+			copy.phase = event.phase.load(std::memory_order_relaxed);
+			events.push_back(copy);
+		}
+
+		// skip the slots the thread wrapped around to while copying,
+		// including the slot of event newHead it may be writing now.
+		// The fence keeps the slot loads above before the head load
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long newHead = pBuffer->head.load(std::memory_order_relaxed);
+		size_t skipped = 0;
+		if (newHead + 1 > EVENTS_PER_THREAD + first)
+		{
+			skipped = (size_t)std::min<unsigned long long>(newHead + 1 - EVENTS_PER_THREAD - first, events.size());
+		}
+
+		int depth = 0;
+		for (size_t i = skipped; i < events.size(); i++)
+		{
+			const EVENT_COPY& event = events[i];
+			if (event.phase == 'E')
+			{
+				if (depth == 0)
+				{
+					continue;
+				}
+				depth--;
+			}
+			else
+			{
+				depth++;
+			}
+
+			traceFile << "," << std::endl << "{\"name\":";
+			WriteJSONString(traceFile, (nullptr != event.name) ? event.name : "");
+			traceFile << ",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp / 1000.0
+				<< ",\"pid\":1,\"tid\":" << pBuffer->threadID << "}";
+			eventCount++;
+		}
+	}
+	traceFile << std::endl << "]}" << std::endl;
+
+	if (!traceFile.good())
+	{
+		std::cout << "Could not write trace file:" << filename << std::endl;
+		return(false);
+	}
+	std::cout << "INFO: Wrote " << eventCount << " trace events to " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ScopedEvent()
+ *
+ *  The constructor for the class, records the begin event
+ ***********************************************************/
+TraceRecorder::ScopedEvent::ScopedEvent(const char* name)
+{
+	m_name = name;
+	m_bRecorded = TraceRecorder::IsEnabled();
+	if (m_bRecorded)
+	{
+		TraceRecorder::BeginEvent(m_name);
+	}
+}
+
+/***********************************************************
+ *  ~ScopedEvent()
+ *
+ *  The destructor for the class, records the end event
+ ***********************************************************/
+TraceRecorder::ScopedEvent::~ScopedEvent()
+{
+	if (m_bRecorded)
+	{
+		TraceRecorder::EndEvent(m_name);
+	}
+}
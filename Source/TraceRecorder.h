@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// tracerecorder.h
+// ============
+// record begin and end events of every thread for a trace viewer
+//
+//  Each thread records its events into its own ring buffer, so recording
+//  takes no lock and never waits on another thread; once a ring is full
+//  its oldest events are overwritten.  On demand the rings are written as
+//  a Chrome trace_event JSON file, which chrome://tracing and Perfetto
+//  open as a timeline with one track per thread.  Event names must be
+//  string literals, since only their pointers are recorded.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/***********************************************************
+ *  TraceRecorder
+ *
+ *  This class contains the methods for recording trace
+ *  events and writing them to a trace file.
+ ***********************************************************/
+class TraceRecorder
+{
+public:
+	// records a begin event now and the matching end event when
+	// it goes out of scope
+	class ScopedEvent
+	{
+	public:
+		ScopedEvent(const char* name);
+		~ScopedEvent();
+
+	private:
+		const char* m_name;
+		bool m_bRecorded;
+	};
+
+	// start or stop recording, events are dropped while stopped
+	static void SetEnabled(bool bEnabled);
+	static bool IsEnabled();
+	// set the file WriteTrace writes to
+	static void SetOutputPath(const std::string& outputPath);
+	// name the track of the calling thread
+	static void SetThreadName(const char* name);
+
+	// record a begin or end event on the calling thread
+	static void BeginEvent(const char* name);
+	static void EndEvent(const char* name);
+
+	// write the recorded events of every thread to the output
+	// path, or to the passed in file
+	static bool WriteTrace();
+	static bool WriteTrace(const std::string& filename);
+
+	// write the passed in text as a quoted JSON string
+	static void WriteJSONString(std::ostream& output, const std::string& text);
+
+private:
+	static void AddEvent(const char* name, char phase);
+};
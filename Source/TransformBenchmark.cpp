@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbenchmark.cpp
+// ============
+// microbenchmark of the model matrix composition paths
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformBenchmark.h"
+#include "TransformStore.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+	/***********************************************************
+	 *  ComposeWithMatrices()
+	 *
+	 *  Composes a model matrix the way the scene manager
+	 *  originally did, as a product of the individual scale,
+	 *  rotation and translation matrices.
+	 ***********************************************************/
+	glm::mat4 ComposeWithMatrices(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+	{
+		glm::mat4 scale = glm::scale(scaleXYZ);
+		glm::mat4 rotationX = glm::rotate(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 translation = glm::translate(positionXYZ);
+
+		return(translation * rotationX * rotationY * rotationZ * scale);
+	}
+
+	/***********************************************************
+	 *  NanosecondsPerMatrix()
+	 *
+	 *  Nanoseconds spent per matrix between two clock samples.
+	 ***********************************************************/
+	double NanosecondsPerMatrix(BenchmarkClock::time_point start, BenchmarkClock::time_point end, int matrices)
+	{
+		double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		return(nanoseconds / (double)std::max(matrices, 1));
+	}
+}
+
+/***********************************************************
+ *  RunTransformBenchmark()
+ *
+ *  This function is used for timing the model matrix
+ *  composition paths over the same generated transforms,
+ *  and checking that the batch kernel agrees with the glm
+ *  matrix product.
+ ***********************************************************/
+void RunTransformBenchmark(int objectCount, int iterations)
+{
+	objectCount = std::max(objectCount, 1);
+	iterations = std::max(iterations, 1);
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> angle(-360.0f, 360.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+	std::vector<glm::vec3> scales(objectCount);
+	std::vector<glm::vec3> rotations(objectCount);
+	std::vector<glm::vec3> positions(objectCount);
+	TransformStore transforms;
+	transforms.Reserve(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		scales[i] = glm::vec3(size(generator), size(generator), size(generator));
+		rotations[i] = glm::vec3(angle(generator), angle(generator), angle(generator));
+		positions[i] = glm::vec3(position(generator), position(generator), position(generator));
+		transforms.Add(scales[i], rotations[i], positions[i]);
+	}
+
+	std::vector<glm::mat4> matrices(objectCount);
+	int totalMatrices = objectCount * iterations;
+
+	// product of the individual transform matrices
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (int i = 0; i < objectCount; i++)
+		{
+			matrices[i] = ComposeWithMatrices(scales[i], rotations[i], positions[i]);
+		}
+	}
+	double matrixProductTime = NanosecondsPerMatrix(start, BenchmarkClock::now(), totalMatrices);
+
+	// closed form, one transform at a time
+	float checksum = 0.0f;
+	start = BenchmarkClock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (int i = 0; i < objectCount; i++)
+		{
+			glm::mat4 matrix = TransformStore::ComposeMatrix(scales[i], rotations[i], positions[i]);
+			checksum += matrix[0][0];
+		}
+	}
+	double scalarTime = NanosecondsPerMatrix(start, BenchmarkClock::now(), totalMatrices);
+
+	// batch kernel over the structure of arrays
+	start = BenchmarkClock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		transforms.ComposeRange(0, objectCount);
+	}
+	double batchTime = NanosecondsPerMatrix(start, BenchmarkClock::now(), totalMatrices);
+
+	// largest difference between the kernel and the matrix product
+	float maxError = 0.0f;
+	for (int i = 0; i < objectCount; i++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				float error = std::fabs(transforms.GetMatrix(i)[column][row] - matrices[i][column][row]);
+				maxError = std::max(maxError, error);
+			}
+		}
+	}
+
+	std::cout << "Transform benchmark, objects:" << objectCount << ", iterations:" << iterations << std::endl;
+	std::cout << "  matrix product: " << matrixProductTime << " ns/matrix" << std::endl;
+	std::cout << "  scalar closed form: " << scalarTime << " ns/matrix (checksum " << checksum << ")" << std::endl;
+	std::cout << "  batch kernel: " << batchTime << " ns/matrix, "
+		<< (batchTime > 0.0 ? matrixProductTime / batchTime : 0.0) << "x faster" << std::endl;
+	std::cout << "  max difference from matrix product: " << maxError << std::endl;
+}
@@ -0,0 +1,12 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbenchmark.h
+// ============
+// microbenchmark of the model matrix composition paths
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// compose the model matrices of a generated set of transforms with the
+// glm matrix product, the scalar closed form and the batch kernel, and
+// print the time per matrix of each path
+void RunTransformBenchmark(int objectCount, int iterations);
@@ -0,0 +1,404 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.cpp
+// ============
+// structure of arrays storage and batch composition of object transforms
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <cmath>
+
+// SSE2 is part of every x86-64 target, other targets use the
+// scalar version of the kernel
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TRANSFORM_STORE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	const float DEGREES_TO_RADIANS = 0.0174532925199f;
+
+#ifdef TRANSFORM_STORE_SSE2
+	/***********************************************************
+	 *  SinCos4()
+	 *
+	 *  Computes the sine and cosine of four angles in radians.
+	 *  The angles are reduced to [-pi/4, pi/4] around the
+	 *  nearest multiple of pi/2, evaluated with minimax
+	 *  polynomials, and the quadrant selects and signs the
+	 *  results.
+	 ***********************************************************/
+	void SinCos4(__m128 angles, __m128& sines, __m128& cosines)
+	{
+		const __m128 twoOverPi = _mm_set1_ps(0.636619772f);
+		const __m128 piOverTwoHigh = _mm_set1_ps(1.5703125f);
+		const __m128 piOverTwoLow = _mm_set1_ps(4.838267949e-4f);
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i two = _mm_set1_epi32(2);
+
+		// reduce the angles around the nearest quadrant
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angles, twoOverPi));
+		__m128 quadrantFloat = _mm_cvtepi32_ps(quadrant);
+		__m128 reduced = _mm_sub_ps(angles, _mm_mul_ps(quadrantFloat, piOverTwoHigh));
+		reduced = _mm_sub_ps(reduced, _mm_mul_ps(quadrantFloat, piOverTwoLow));
+		__m128 reducedSquared = _mm_mul_ps(reduced, reduced);
+
+		// sine polynomial
+		__m128 sinePoly = _mm_set1_ps(-1.9515295891e-4f);
+		sinePoly = _mm_add_ps(_mm_mul_ps(sinePoly, reducedSquared), _mm_set1_ps(8.3321608736e-3f));
+		sinePoly = _mm_add_ps(_mm_mul_ps(sinePoly, reducedSquared), _mm_set1_ps(-1.6666654611e-1f));
+		sinePoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinePoly, reducedSquared), reduced), reduced);
+
+		// cosine polynomial
+		__m128 cosinePoly = _mm_set1_ps(2.443315711809948e-5f);
+		cosinePoly = _mm_add_ps(_mm_mul_ps(cosinePoly, reducedSquared), _mm_set1_ps(-1.388731625493765e-3f));
+		cosinePoly = _mm_add_ps(_mm_mul_ps(cosinePoly, reducedSquared), _mm_set1_ps(4.166664568298827e-2f));
+		cosinePoly = _mm_mul_ps(_mm_mul_ps(cosinePoly, reducedSquared), reducedSquared);
+		cosinePoly = _mm_add_ps(cosinePoly, _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(reducedSquared, _mm_set1_ps(0.5f))));
+
+		// odd quadrants swap the sine and cosine
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+		__m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+		__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+		sines = _mm_or_ps(_mm_and_ps(swap, cosinePoly), _mm_andnot_ps(swap, sinePoly));
+		cosines = _mm_or_ps(_mm_and_ps(swap, sinePoly), _mm_andnot_ps(swap, cosinePoly));
+		sines = _mm_xor_ps(sines, sineSign);
+		cosines = _mm_xor_ps(cosines, cosineSign);
+	}
+
+	/***********************************************************
+	 *  Compose4()
+	 *
+	 *  Composes translation * rotX * rotY * rotZ * scale for
+	 *  four transforms, each input register holding one
+	 *  component of the four transforms.  The first count
+	 *  matrices are written to the output pointers.
+	 ***********************************************************/
+	void Compose4(
+		__m128 positionX, __m128 positionY, __m128 positionZ,
+		__m128 rotationX, __m128 rotationY, __m128 rotationZ,
+		__m128 scaleX, __m128 scaleY, __m128 scaleZ,
+		glm::mat4* outputs[4], int count)
+	{
+		const __m128 toRadians = _mm_set1_ps(DEGREES_TO_RADIANS);
+		__m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+		SinCos4(_mm_mul_ps(rotationX, toRadians), sinX, cosX);
+		SinCos4(_mm_mul_ps(rotationY, toRadians), sinY, cosY);
+		SinCos4(_mm_mul_ps(rotationZ, toRadians), sinZ, cosZ);
+
+		__m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+		__m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+		__m128 zero = _mm_setzero_ps();
+
+		// one register per matrix element, columns scaled
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), scaleX);
+		columns[0][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cosX, sinZ), _mm_mul_ps(sinXsinY, cosZ)), scaleX);
+		columns[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cosXsinY, cosZ)), scaleX);
+		columns[0][3] = zero;
+		columns[1][0] = _mm_mul_ps(_mm_sub_ps(zero, _mm_mul_ps(cosY, sinZ)), scaleY);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sinXsinY, sinZ)), scaleY);
+		columns[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sinX, cosZ), _mm_mul_ps(cosXsinY, sinZ)), scaleY);
+		columns[1][3] = zero;
+		columns[2][0] = _mm_mul_ps(sinY, scaleZ);
+		columns[2][1] = _mm_mul_ps(_mm_sub_ps(zero, _mm_mul_ps(sinX, cosY)), scaleZ);
+		columns[2][2] = _mm_mul_ps(_mm_mul_ps(cosX, cosY), scaleZ);
+		columns[2][3] = zero;
+		columns[3][0] = positionX;
+		columns[3][1] = positionY;
+		columns[3][2] = positionZ;
+		columns[3][3] = _mm_set1_ps(1.0f);
+
+		// transpose each column so every register holds the
+		// column of one transform, then store it
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 r0 = columns[column][0];
+			__m128 r1 = columns[column][1];
+			__m128 r2 = columns[column][2];
+			__m128 r3 = columns[column][3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			__m128 lanes[4] = { r0, r1, r2, r3 };
+			for (int lane = 0; lane < count; lane++)
+			{
+				_mm_storeu_ps(&(*outputs[lane])[column][0], lanes[lane]);
+			}
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  TransformStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformStore::TransformStore()
+{
+}
+
+/***********************************************************
+ *  ~TransformStore()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TransformStore::~TransformStore()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every transform.
+ ***********************************************************/
+void TransformStore::Clear()
+{
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_rotationX.clear();
+	m_rotationY.clear();
+	m_rotationZ.clear();
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_dirty.clear();
+	m_matrices.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for reserving room in every array.
+ ***********************************************************/
+void TransformStore::Reserve(int transformCount)
+{
+	m_positionX.reserve(transformCount);
+	m_positionY.reserve(transformCount);
+	m_positionZ.reserve(transformCount);
+	m_rotationX.reserve(transformCount);
+	m_rotationY.reserve(transformCount);
+	m_rotationZ.reserve(transformCount);
+	m_scaleX.reserve(transformCount);
+	m_scaleY.reserve(transformCount);
+	m_scaleZ.reserve(transformCount);
+	m_dirty.reserve(transformCount);
+	m_matrices.reserve(transformCount);
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for appending a transform.  It is
+ *  marked dirty so its matrix is composed on the next
+ *  ComposeDirtyRange.
+ ***********************************************************/
+int TransformStore::Add(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+{
+	m_positionX.push_back(positionXYZ.x);
+	m_positionY.push_back(positionXYZ.y);
+	m_positionZ.push_back(positionXYZ.z);
+	m_rotationX.push_back(rotationDegrees.x);
+	m_rotationY.push_back(rotationDegrees.y);
+	m_rotationZ.push_back(rotationDegrees.z);
+	m_scaleX.push_back(scaleXYZ.x);
+	m_scaleY.push_back(scaleXYZ.y);
+	m_scaleZ.push_back(scaleXYZ.z);
+	m_dirty.push_back(1);
+	m_matrices.push_back(glm::mat4(1.0f));
+
+	return((int)m_matrices.size() - 1);
+}
+
+/***********************************************************
+ *  Set()
+ *
+ *  This method is used for replacing the values of a
+ *  transform and marking it dirty.
+ ***********************************************************/
+void TransformStore::Set(int index, glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+{
+	if ((index < 0) || (index >= GetCount()))
+	{
+		return;
+	}
+
+	m_positionX[index] = positionXYZ.x;
+	m_positionY[index] = positionXYZ.y;
+	m_positionZ[index] = positionXYZ.z;
+	m_rotationX[index] = rotationDegrees.x;
+	m_rotationY[index] = rotationDegrees.y;
+	m_rotationZ[index] = rotationDegrees.z;
+	m_scaleX[index] = scaleXYZ.x;
+	m_scaleY[index] = scaleXYZ.y;
+	m_scaleZ[index] = scaleXYZ.z;
+	m_dirty[index] = 1;
+}
+
+/***********************************************************
+ *  ComposeDirtyRange()
+ *
+ *  This method is used for composing the dirty matrices of
+ *  a range of transforms.  Only the range is read and
+ *  written, so disjoint ranges are safe to compose at the
+ *  same time.
+ ***********************************************************/
+int TransformStore::ComposeDirtyRange(int firstIndex, int count, std::vector<int>& rebuiltIndices)
+{
+	int batch[4];
+	int batchCount = 0;
+	int rebuilt = 0;
+	int endIndex = std::min(firstIndex + count, GetCount());
+
+	for (int i = firstIndex; i < endIndex; i++)
+	{
+		if (m_dirty[i] == 0)
+		{
+			continue;
+		}
+
+		m_dirty[i] = 0;
+		rebuiltIndices.push_back(i);
+		batch[batchCount++] = i;
+		if (batchCount == 4)
+		{
+			ComposeBatch(batch, batchCount);
+			rebuilt += batchCount;
+			batchCount = 0;
+		}
+	}
+
+	if (batchCount > 0)
+	{
+		ComposeBatch(batch, batchCount);
+		rebuilt += batchCount;
+	}
+
+	return(rebuilt);
+}
+
+/***********************************************************
+ *  ComposeRange()
+ *
+ *  This method is used for composing the matrices of a
+ *  contiguous range of transforms, loading four of each
+ *  component at a time straight from the arrays.
+ ***********************************************************/
+void TransformStore::ComposeRange(int firstIndex, int count)
+{
+	int index = firstIndex;
+	int endIndex = firstIndex + count;
+
+#ifdef TRANSFORM_STORE_SSE2
+	for (; index + 4 <= endIndex; index += 4)
+	{
+		glm::mat4* outputs[4] =
+		{
+			&m_matrices[index], &m_matrices[index + 1], &m_matrices[index + 2], &m_matrices[index + 3]
+		};
+		Compose4(
+			_mm_loadu_ps(&m_positionX[index]), _mm_loadu_ps(&m_positionY[index]), _mm_loadu_ps(&m_positionZ[index]),
+			_mm_loadu_ps(&m_rotationX[index]), _mm_loadu_ps(&m_rotationY[index]), _mm_loadu_ps(&m_rotationZ[index]),
+			_mm_loadu_ps(&m_scaleX[index]), _mm_loadu_ps(&m_scaleY[index]), _mm_loadu_ps(&m_scaleZ[index]),
+			outputs, 4);
+		m_dirty[index] = m_dirty[index + 1] = m_dirty[index + 2] = m_dirty[index + 3] = 0;
+	}
+#endif
+
+	// the remaining transforms
+	int batch[4];
+	int batchCount = 0;
+	for (; index < endIndex; index++)
+	{
+		m_dirty[index] = 0;
+		batch[batchCount++] = index;
+	}
+	if (batchCount > 0)
+	{
+		ComposeBatch(batch, batchCount);
+	}
+}
+
+/***********************************************************
+ *  ComposeBatch()
+ *
+ *  This method is used for composing up to four matrices
+ *  of arbitrary transforms.
+ ***********************************************************/
+void TransformStore::ComposeBatch(const int indices[4], int count)
+{
+#ifdef TRANSFORM_STORE_SSE2
+	// unused lanes repeat the first transform
+	int lanes[4];
+	glm::mat4* outputs[4];
+	for (int i = 0; i < 4; i++)
+	{
+		lanes[i] = indices[(i < count) ? i : 0];
+		outputs[i] = &m_matrices[lanes[i]];
+	}
+
+	Compose4(
+		_mm_setr_ps(m_positionX[lanes[0]], m_positionX[lanes[1]], m_positionX[lanes[2]], m_positionX[lanes[3]]),
+		_mm_setr_ps(m_positionY[lanes[0]], m_positionY[lanes[1]], m_positionY[lanes[2]], m_positionY[lanes[3]]),
+		_mm_setr_ps(m_positionZ[lanes[0]], m_positionZ[lanes[1]], m_positionZ[lanes[2]], m_positionZ[lanes[3]]),
+		_mm_setr_ps(m_rotationX[lanes[0]], m_rotationX[lanes[1]], m_rotationX[lanes[2]], m_rotationX[lanes[3]]),
+		_mm_setr_ps(m_rotationY[lanes[0]], m_rotationY[lanes[1]], m_rotationY[lanes[2]], m_rotationY[lanes[3]]),
+		_mm_setr_ps(m_rotationZ[lanes[0]], m_rotationZ[lanes[1]], m_rotationZ[lanes[2]], m_rotationZ[lanes[3]]),
+		_mm_setr_ps(m_scaleX[lanes[0]], m_scaleX[lanes[1]], m_scaleX[lanes[2]], m_scaleX[lanes[3]]),
+		_mm_setr_ps(m_scaleY[lanes[0]], m_scaleY[lanes[1]], m_scaleY[lanes[2]], m_scaleY[lanes[3]]),
+		_mm_setr_ps(m_scaleZ[lanes[0]], m_scaleZ[lanes[1]], m_scaleZ[lanes[2]], m_scaleZ[lanes[3]]),
+		outputs, count);
+#else
+	for (int i = 0; i < count; i++)
+	{
+		int index = indices[i];
+		m_matrices[index] = ComposeMatrix(
+			glm::vec3(m_scaleX[index], m_scaleY[index], m_scaleZ[index]),
+			glm::vec3(m_rotationX[index], m_rotationY[index], m_rotationZ[index]),
+			glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]));
+	}
+#endif
+}
+
+/***********************************************************
+ *  ComposeMatrix()
+ *
+ *  This method is used for composing a single model matrix
+ *  from sines and cosines, equal to the product
+ *  translation * rotX * rotY * rotZ * scale.
+ ***********************************************************/
+glm::mat4 TransformStore::ComposeMatrix(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+{
+	float sinX = sinf(rotationDegrees.x * DEGREES_TO_RADIANS);
+	float cosX = cosf(rotationDegrees.x * DEGREES_TO_RADIANS);
+	float sinY = sinf(rotationDegrees.y * DEGREES_TO_RADIANS);
+	float cosY = cosf(rotationDegrees.y * DEGREES_TO_RADIANS);
+	float sinZ = sinf(rotationDegrees.z * DEGREES_TO_RADIANS);
+	float cosZ = cosf(rotationDegrees.z * DEGREES_TO_RADIANS);
+
+	glm::mat4 matrix(1.0f);
+	matrix[0] = glm::vec4(
+		cosY * cosZ,
+		cosX * sinZ + sinX * sinY * cosZ,
+		sinX * sinZ - cosX * sinY * cosZ,
+		0.0f) * scaleXYZ.x;
+	matrix[1] = glm::vec4(
+		-cosY * sinZ,
+		cosX * cosZ - sinX * sinY * sinZ,
+		sinX * cosZ + cosX * sinY * sinZ,
+		0.0f) * scaleXYZ.y;
+	matrix[2] = glm::vec4(
+		sinY,
+		-sinX * cosY,
+		cosX * cosY,
+		0.0f) * scaleXYZ.z;
+	matrix[3] = glm::vec4(positionXYZ, 1.0f);
+
+	return(matrix);
+}
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.h
+// ============
+// structure of arrays storage and batch composition of object transforms
+//
+//  Positions, Euler angles and scales are kept in separate float arrays so
+//  the model matrices of four objects can be composed at once with SSE,
+//  directly from the sines and cosines of the angles, without building the
+//  intermediate scale, rotation and translation matrices.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TransformStore
+ *
+ *  This class contains the transform values and composed
+ *  model matrices of the scene objects, indexed by object.
+ ***********************************************************/
+class TransformStore
+{
+public:
+	// constructor
+	TransformStore();
+	// destructor
+	~TransformStore();
+
+	// remove every transform
+	void Clear();
+	// reserve room for a number of transforms
+	void Reserve(int transformCount);
+	// append a transform, marked dirty, and get its index
+	int Add(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ);
+	// replace the values of a transform and mark it dirty
+	void Set(int index, glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ);
+
+	// compose the dirty matrices within a range of transforms,
+	// separate ranges can be composed on separate threads
+	int ComposeDirtyRange(int firstIndex, int count, std::vector<int>& rebuiltIndices);
+	// compose the matrices of a contiguous range of transforms
+	void ComposeRange(int firstIndex, int count);
+
+	int GetCount() const { return (int)m_matrices.size(); }
+	const glm::mat4& GetMatrix(int index) const { return m_matrices[index]; }
+	glm::vec3 GetPosition(int index) const { return glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]); }
+
+	// compose one matrix with the same math as the batch kernel
+	static glm::mat4 ComposeMatrix(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ);
+
+private:
+	// transform values, one array per component
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	// 1 when the matrix has to be recomposed
+	std::vector<uint8_t> m_dirty;
+	// composed model matrices
+	std::vector<glm::mat4> m_matrices;
+
+	// indices gathered for one batch of the kernel
+	void ComposeBatch(const int indices[4], int count);
+};
@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.cpp
+// ============
+// cache the uniform locations of a shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+/***********************************************************
+ *  UniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformCache::UniformCache(GLuint programID)
+{
+	m_programID = programID;
+	m_lookupCount = 0;
+	m_submittedCount = 0;
+	m_skippedCount = 0;
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		m_boundTextures[i] = UNKNOWN_TEXTURE;
+	}
+}
+
+/***********************************************************
+ *  ~UniformCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformCache::~UniformCache()
+{
+	m_uniforms.clear();
+	m_handles.clear();
+}
+
+/***********************************************************
+ *  GetHandle()
+ *
+ *  This method is used for registering a uniform by name.
+ *  The location is queried from OpenGL the first time a
+ *  name is seen; later calls return the existing handle.
+ *  Names the program has optimized out or never declared
+ *  are remembered as INVALID_HANDLE, so callers can tell
+ *  which features the active shader supports.
+ ***********************************************************/
+int UniformCache::GetHandle(const char* uniformName)
+{
+	auto found = m_handles.find(uniformName);
+	if (found != m_handles.end())
+	{
+		return(found->second);
+	}
+
+	UNIFORM_ENTRY entry;
+	entry.name = uniformName;
+	entry.location = glGetUniformLocation(m_programID, uniformName);
+	entry.bHasValue = false;
+	m_lookupCount++;
+	if (entry.location == -1)
+	{
+		m_handles[entry.name] = INVALID_HANDLE;
+		return(INVALID_HANDLE);
+	}
+
+	int handle = (int)m_uniforms.size();
+	m_uniforms.push_back(entry);
+	m_handles[entry.name] = handle;
+
+	return(handle);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for resetting the per-frame
+ *  lookup and state change counters.
+ ***********************************************************/
+void UniformCache::BeginFrame()
+{
+	m_lookupCount = 0;
+	m_submittedCount = 0;
+	m_skippedCount = 0;
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting every remembered
+ *  uniform value and texture binding, so the next set of
+ *  each one is submitted to OpenGL.
+ ***********************************************************/
+void UniformCache::Invalidate()
+{
+	for (UNIFORM_ENTRY& entry : m_uniforms)
+	{
+		entry.bHasValue = false;
+	}
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		m_boundTextures[i] = UNKNOWN_TEXTURE;
+	}
+}
+
+/***********************************************************
+ *  UpdateShadow()
+ *
+ *  This method is used for comparing a uniform value with
+ *  the last value submitted for the same handle.  Returns
+ *  false when the value is identical and the set can be
+ *  skipped, otherwise stores the new value and returns true.
+ ***********************************************************/
+bool UniformCache::UpdateShadow(int handle, const void* value, int byteCount)
+{
+	if ((handle < 0) || (handle >= (int)m_uniforms.size()))
+	{
+		return(false);
+	}
+
+	UNIFORM_ENTRY& entry = m_uniforms[handle];
+	if ((entry.bHasValue) && (memcmp(entry.shadow, value, byteCount) == 0))
+	{
+		m_skippedCount++;
+		return(false);
+	}
+
+	memcpy(entry.shadow, value, byteCount);
+	entry.bHasValue = true;
+	m_submittedCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to a texture
+ *  unit, skipping the bind when the unit already holds it.
+ ***********************************************************/
+void UniformCache::BindTexture(int textureUnit, GLenum target, GLuint textureID)
+{
+	if ((textureUnit >= 0) && (textureUnit < MAX_TEXTURE_UNITS))
+	{
+		if (m_boundTextures[textureUnit] == textureID)
+		{
+			m_skippedCount++;
+			return;
+		}
+		m_boundTextures[textureUnit] = textureID;
+	}
+
+	m_submittedCount++;
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(target, textureID);
+}
+
+/***********************************************************
+ *  SetBoolValue()
+ *
+ *  This method is used for setting a bool uniform.
+ ***********************************************************/
+void UniformCache::SetBoolValue(int handle, bool value)
+{
+	SetIntValue(handle, (int)value);
+}
+
+/***********************************************************
+ *  SetIntValue()
+ *
+ *  This method is used for setting an int uniform.
+ ***********************************************************/
+void UniformCache::SetIntValue(int handle, int value)
+{
+	if (!UpdateShadow(handle, &value, sizeof(value)))
+	{
+		return;
+	}
+
+	glUniform1i(m_uniforms[handle].location, value);
+}
+
+/***********************************************************
+ *  SetFloatValue()
+ *
+ *  This method is used for setting a float uniform.
+ ***********************************************************/
+void UniformCache::SetFloatValue(int handle, float value)
+{
+	if (!UpdateShadow(handle, &value, sizeof(value)))
+	{
+		return;
+	}
+
+	glUniform1f(m_uniforms[handle].location, value);
+}
+
+/***********************************************************
+ *  SetVec2Value()
+ *
+ *  This method is used for setting a vec2 uniform.
+ ***********************************************************/
+void UniformCache::SetVec2Value(int handle, const glm::vec2& value)
+{
+	if (!UpdateShadow(handle, glm::value_ptr(value), sizeof(glm::vec2)))
+	{
+		return;
+	}
+
+	glUniform2fv(m_uniforms[handle].location, 1, glm::value_ptr(value));
+}
+
+/***********************************************************
+ *  SetVec3Value()
+ *
+ *  This method is used for setting a vec3 uniform.
+ ***********************************************************/
+void UniformCache::SetVec3Value(int handle, const glm::vec3& value)
+{
+	if (!UpdateShadow(handle, glm::value_ptr(value), sizeof(glm::vec3)))
+	{
+		return;
+	}
+
+	glUniform3fv(m_uniforms[handle].location, 1, glm::value_ptr(value));
+}
+
+/***********************************************************
+ *  SetVec4Value()
+ *
+ *  This method is used for setting a vec4 uniform.
+ ***********************************************************/
+void UniformCache::SetVec4Value(int handle, const glm::vec4& value)
+{
+	if (!UpdateShadow(handle, glm::value_ptr(value), sizeof(glm::vec4)))
+	{
+		return;
+	}
+
+	glUniform4fv(m_uniforms[handle].location, 1, glm::value_ptr(value));
+}
+
+/***********************************************************
+ *  SetMat4Value()
+ *
+ *  This method is used for setting a mat4 uniform.
+ ***********************************************************/
+void UniformCache::SetMat4Value(int handle, const glm::mat4& value)
+{
+	if (!UpdateShadow(handle, glm::value_ptr(value), sizeof(glm::mat4)))
+	{
+		return;
+	}
+
+	glUniformMatrix4fv(m_uniforms[handle].location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+/***********************************************************
+ *  SetSampler2DValue()
+ *
+ *  This method is used for pointing a sampler uniform at
+ *  a texture slot.
+ ***********************************************************/
+void UniformCache::SetSampler2DValue(int handle, int textureSlot)
+{
+	SetIntValue(handle, textureSlot);
+}
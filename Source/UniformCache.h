@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// cache the uniform locations of a shader program
+//
+//  Uniforms are registered by name once, after the shader program has been
+//  loaded, and are set afterwards through the returned integer handle so
+//  the render loop never calls glGetUniformLocation.  The last value set
+//  for every uniform and texture unit is remembered, and identical
+//  re-submissions are skipped before they reach OpenGL.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  UniformCache
+ *
+ *  This class contains the resolved uniform locations of
+ *  one shader program, typed setters that take handles,
+ *  and the shadow copies used to filter redundant state.
+ ***********************************************************/
+class UniformCache
+{
+public:
+	// constructor
+	UniformCache(GLuint programID);
+	// destructor
+	~UniformCache();
+
+	// handle value returned for names that are not active
+	// uniforms in the program, the setters ignore it
+	static const int INVALID_HANDLE = -1;
+
+	// register a uniform by name and get its handle, or
+	// INVALID_HANDLE when the program has no such uniform
+	int GetHandle(const char* uniformName);
+
+	// set uniform values through a handle
+	void SetBoolValue(int handle, bool value);
+	void SetIntValue(int handle, int value);
+	void SetFloatValue(int handle, float value);
+	void SetVec2Value(int handle, const glm::vec2& value);
+	void SetVec3Value(int handle, const glm::vec3& value);
+	void SetVec4Value(int handle, const glm::vec4& value);
+	void SetMat4Value(int handle, const glm::mat4& value);
+	void SetSampler2DValue(int handle, int textureSlot);
+
+	// bind a texture to a texture unit unless it is already bound
+	void BindTexture(int textureUnit, GLenum target, GLuint textureID);
+
+	// forget the remembered values, for when state was changed
+	// behind the cache's back
+	void Invalidate();
+
+	// reset the per-frame counters
+	void BeginFrame();
+	// number of glGetUniformLocation calls since BeginFrame
+	int GetLookupCount() const { return m_lookupCount; }
+	// number of state changes passed on to OpenGL since BeginFrame
+	int GetSubmittedCount() const { return m_submittedCount; }
+	// number of identical state changes skipped since BeginFrame
+	int GetSkippedCount() const { return m_skippedCount; }
+
+	GLuint GetProgramID() const { return m_programID; }
+
+private:
+	// largest uniform value that is shadowed, a mat4
+	static const int MAX_SHADOW_FLOATS = 16;
+	// texture units whose bindings are shadowed
+	static const int MAX_TEXTURE_UNITS = 32;
+
+	struct UNIFORM_ENTRY
+	{
+		std::string name;
+		GLint location;
+		// last value passed to OpenGL, valid when bHasValue is set
+		float shadow[MAX_SHADOW_FLOATS];
+		bool bHasValue;
+	};
+
+	// compare a value with the shadow copy, returning true
+	// when it differs and has to be submitted
+	bool UpdateShadow(int handle, const void* value, int byteCount);
+
+	// shader program the locations belong to
+	GLuint m_programID;
+	// registered uniforms, indexed by handle
+	std::vector<UNIFORM_ENTRY> m_uniforms;
+	// name to handle lookup table
+	std::unordered_map<std::string, int> m_handles;
+	// location lookups issued since the last BeginFrame
+	int m_lookupCount;
+	// marks a texture unit whose binding is not known, which
+	// cannot match any texture name including 0
+	static const GLuint UNKNOWN_TEXTURE = ~0u;
+	// texture bound to each texture unit, UNKNOWN_TEXTURE when
+	// it has not been bound through the cache
+	GLuint m_boundTextures[MAX_TEXTURE_UNITS];
+	// state changes submitted and skipped since the last BeginFrame
+	int m_submittedCount;
+	int m_skippedCount;
+};
@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "TraceRecorder.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
@@ -22,6 +23,7 @@ namespace
 	const int WINDOW_HEIGHT = 800;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -39,6 +41,94 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// true while the trace key is held, so a trace is only
+	// written once per press
+	bool bTraceKeyDown = false;
+
+	// true while a camera path or an input log drives the
+	// camera, so the mouse callbacks leave it alone
+	bool bCameraPathPlaying = false;
+	bool bInputReplaying = false;
+
+	// true when the view has to be drawn again, set by the input
+	// and window callbacks and by held keys
+	bool bViewDirty = true;
+
+	// input log of the view manager, for the mouse callbacks
+	InputRecorder* g_pInputRecorder = nullptr;
+
+	// keys sampled every frame, bit i of the key state is the
+	// i-th key of the list
+	const int TRACKED_KEYS[] = {
+		GLFW_KEY_ESCAPE, GLFW_KEY_F12,
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E,
+		GLFW_KEY_P, GLFW_KEY_O };
+	const int TRACKED_KEY_COUNT = sizeof(TRACKED_KEYS) / sizeof(TRACKED_KEYS[0]);
+	// position of the escape key in the list
+	const int ESCAPE_KEY_INDEX = 0;
+
+	/***********************************************************
+	 *  IsKeyDown()
+	 *
+	 *  This function is used for checking whether the passed
+	 *  in key is pressed in a sampled key state.
+	 ***********************************************************/
+	bool IsKeyDown(unsigned int keyState, int key)
+	{
+		for (int i = 0; i < TRACKED_KEY_COUNT; i++)
+		{
+			if (TRACKED_KEYS[i] == key)
+			{
+				return((keyState & (1u << i)) != 0);
+			}
+		}
+
+		return(false);
+	}
+
+	/***********************************************************
+	 *  ApplyScroll()
+	 *
+	 *  This function is used for zooming the camera for a
+	 *  live or replayed scroll.
+	 ***********************************************************/
+	void ApplyScroll(double yOffset)
+	{
+		// making the yOffset negative flips the scroll wheels functionality.
+		// it makes more sense that up is more sensitive
+		g_pCamera->ProcessMouseScroll(-yOffset);
+	}
+
+	/***********************************************************
+	 *  ApplyCursorPosition()
+	 *
+	 *  This function is used for turning the camera for a
+	 *  live or replayed cursor move.
+	 ***********************************************************/
+	void ApplyCursorPosition(double xMousePos, double yMousePos)
+	{
+		// when the first mouse move event is received, this needs to be recorded so that
+		// all subsequent mouse moves can correctly calculate the X position offset and Y
+		// position offset for proper operation
+		if (gFirstMouse)
+		{
+			gLastX = xMousePos;
+			gLastY = yMousePos;
+			gFirstMouse = false;
+		}
+
+		// calculate the X offset and Y offset values for moving the 3D camera accordingly
+		float xOffset = xMousePos - gLastX;
+		float yOffset = gLastY - yMousePos; // reversed since y-coordinates go from bottom to top
+
+		// set the current positions into the last position variables
+		gLastX = xMousePos;
+		gLastY = yMousePos;
+
+		// move the 3D camera according to the calculated offsets
+		g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	}
 }
 
 /***********************************************************
@@ -51,7 +141,21 @@ ViewManager::ViewManager(
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pUniformCache = NULL;
+	m_viewUniform = UniformCache::INVALID_HANDLE;
+	m_projectionUniform = UniformCache::INVALID_HANDLE;
+	m_viewPositionUniform = UniformCache::INVALID_HANDLE;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
 	m_pWindow = NULL;
+	m_frameWidth = WINDOW_WIDTH;
+	m_frameHeight = WINDOW_HEIGHT;
+	m_bHeadless = false;
+	m_pCameraPath = NULL;
+	m_fixedTimestep = 0.0f;
+	m_playbackFrame = 0;
+	m_recordStart = 0.0f;
+	g_pInputRecorder = &m_inputRecorder;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -69,7 +173,11 @@ ViewManager::~ViewManager()
 {
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pUniformCache = NULL;
 	m_pWindow = NULL;
+	m_pCameraPath = NULL;
+	m_inputRecorder.Stop();
+	g_pInputRecorder = NULL;
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -109,15 +217,165 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to recieve mouse scrolling events
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
 
+	// these callbacks are used to redraw on key presses, resizes
+	// and when the window contents are damaged
+	glfwSetKeyCallback(window, &ViewManager::Key_Callback);
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
+
+	// enable blending for supporting tranparent rendering
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_pWindow = window;
+
+	return(window);
+}
+
+/***********************************************************
+ *  CreateHeadlessWindow()
+ *
+ *  This method is used to create a hidden window whose only
+ *  purpose is to own the OpenGL context, for rendering into
+ *  an offscreen framebuffer.  On the GLFW null platform the
+ *  context is created through OSMesa.  No input is captured
+ *  from the window.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateHeadlessWindow(const char* windowTitle, int frameWidth, int frameHeight)
+{
+	GLFWwindow* window = nullptr;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#if (GLFW_VERSION_MAJOR > 3) || ((GLFW_VERSION_MAJOR == 3) && (GLFW_VERSION_MINOR >= 4))
+	if (glfwGetPlatform() == GLFW_PLATFORM_NULL)
+	{
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	}
+#endif
+
+	// try to create the hidden OpenGL window
+	window = glfwCreateWindow(
+		frameWidth,
+		frameHeight,
+		windowTitle,
+		NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create headless GLFW window" << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
+	m_frameWidth = frameWidth;
+	m_frameHeight = frameHeight;
+	m_bHeadless = true;
 
 	return(window);
 }
 
+/***********************************************************
+ *  SetUniformCache()
+ *
+ *  This method is used for resolving the handles of the
+ *  view uniforms once the shader program has been loaded.
+ ***********************************************************/
+void ViewManager::SetUniformCache(UniformCache* pUniformCache)
+{
+	m_pUniformCache = pUniformCache;
+	if (NULL != m_pUniformCache)
+	{
+		m_viewUniform = m_pUniformCache->GetHandle(g_ViewName);
+		m_projectionUniform = m_pUniformCache->GetHandle(g_ProjectionName);
+		m_viewPositionUniform = m_pUniformCache->GetHandle(g_ViewPositionName);
+	}
+}
+
+/***********************************************************
+ *  SetCameraPath()
+ *
+ *  This method is used for playing back a camera path from
+ *  its start.  Each frame advances the path by the passed
+ *  in timestep, whatever the frame took, and the keyboard
+ *  and mouse no longer move the camera, so every run shows
+ *  the same views.  A NULL path returns to the live input.
+ ***********************************************************/
+void ViewManager::SetCameraPath(const CameraPath* pCameraPath, float timestep)
+{
+	m_pCameraPath = pCameraPath;
+	m_fixedTimestep = timestep;
+	m_playbackFrame = 0;
+}
+
+/***********************************************************
+ *  StartInputRecording()
+ *
+ *  This method is used for recording the frame times, key
+ *  states, cursor moves and scrolls of the run to a binary
+ *  log, from the next frame on.
+ ***********************************************************/
+bool ViewManager::StartInputRecording(const char* filename)
+{
+	if (!m_inputRecorder.StartRecording(filename))
+	{
+		return(false);
+	}
+	m_recordStart = glfwGetTime();
+
+	return(true);
+}
+
+/***********************************************************
+ *  StartInputReplay()
+ *
+ *  This method is used for replaying a binary input log in
+ *  place of the live input.  The recorded frame times are
+ *  used instead of the clock, so each frame sees the same
+ *  camera as when it was recorded, however long the frames
+ *  take now.  The window is closed when the log is done.
+ ***********************************************************/
+bool ViewManager::StartInputReplay(const char* filename)
+{
+	return(m_inputRecorder.StartReplay(filename));
+}
+
+/***********************************************************
+ *  StopInput()
+ *
+ *  This method is used for closing the input log being
+ *  recorded or replayed and reporting its frame count.
+ ***********************************************************/
+void ViewManager::StopInput()
+{
+	if (m_inputRecorder.IsRecording())
+	{
+		std::cout << "INFO: Recorded " << m_inputRecorder.GetFrameCount() << " frames of input" << std::endl;
+	}
+	else if (m_inputRecorder.IsReplaying())
+	{
+		std::cout << "INFO: Replayed " << m_inputRecorder.GetFrameCount() << " frames of input" << std::endl;
+	}
+	m_inputRecorder.Stop();
+}
+
+/***********************************************************
+ *  IsInputReplayDone()
+ *
+ *  This method is used for checking whether a replayed
+ *  input log has run out of frames.  The main loop stops
+ *  before starting a frame the log has no input for, so a
+ *  replay renders exactly the recorded frames.
+ ***********************************************************/
+bool ViewManager::IsInputReplayDone() const
+{
+	return((m_inputRecorder.IsReplaying()) && (!m_inputRecorder.HasNextFrame()));
+}
+
 /***********************************************************
  *  Mouse_Scroll_Callback()
  *
@@ -131,10 +389,18 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset) 
 {
+	// a camera path or input log owns the camera while it plays
+	if ((bCameraPathPlaying) || (bInputReplaying))
+	{
+		return;
+	}
 
-	// making the yOffset negative flips the scroll wheels functionality.
-	// it makes more sense that up is more sensitive
-	g_pCamera->ProcessMouseScroll(-yOffset);
+	if (NULL != g_pInputRecorder)
+	{
+		g_pInputRecorder->RecordScroll(xOffset, yOffset);
+	}
+	ApplyScroll(yOffset);
+	bViewDirty = true;
 }
 
 
@@ -146,84 +412,192 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, doub
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
-	// when the first mouse move event is received, this needs to be recorded so that
-	// all subsequent mouse moves can correctly calculate the X position offset and Y
-	// position offset for proper operation
-	if (gFirstMouse)
+	// a camera path or input log owns the camera while it plays
+	if ((bCameraPathPlaying) || (bInputReplaying))
 	{
-		gLastX = xMousePos;
-		gLastY = yMousePos;
-		gFirstMouse = false;
+		return;
+	}
+
+	if (NULL != g_pInputRecorder)
+	{
+		g_pInputRecorder->RecordCursor(xMousePos, yMousePos);
+	}
+	ApplyCursorPosition(xMousePos, yMousePos);
+	bViewDirty = true;
+}
+
+/***********************************************************
+ *  Key_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a key is pressed, repeated or released.  The keys are
+ *  sampled by PrepareSceneView, so the frame is only marked
+ *  for redrawing here.
+ ***********************************************************/
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	bViewDirty = true;
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the window is resized.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	bViewDirty = true;
+}
+
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the window are damaged and need to be
+ *  drawn again, such as after being uncovered.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow* window)
+{
+	bViewDirty = true;
+}
+
+/***********************************************************
+ *  SampleKeys()
+ *
+ *  This method is used for reading the state of the keys
+ *  used by the scene into one bit each.
+ ***********************************************************/
+unsigned int ViewManager::SampleKeys()
+{
+	// a headless window never receives key presses
+	if (m_bHeadless)
+	{
+		return(0);
 	}
 
-	// calculate the X offset and Y offset values for moving the 3D camera accordingly
-	float xOffset = xMousePos - gLastX;
-	float yOffset = gLastY - yMousePos; // reversed since y-coordinates go from bottom to top
+	unsigned int keyState = 0;
+	for (int i = 0; i < TRACKED_KEY_COUNT; i++)
+	{
+		if (glfwGetKey(m_pWindow, TRACKED_KEYS[i]) == GLFW_PRESS)
+		{
+			keyState |= (1u << i);
+		}
+	}
+
+	return(keyState);
+}
+
+/***********************************************************
+ *  ReadReplayedFrame()
+ *
+ *  This method is used for applying the cursor moves and
+ *  scrolls replayed before the next frame, in their
+ *  recorded order, and taking the frame time and key state
+ *  of that frame.  The main loop checks IsInputReplayDone
+ *  first, so the log only runs out here when it is cut
+ *  short, and then the window is closed.
+ ***********************************************************/
+bool ViewManager::ReadReplayedFrame(unsigned int& keyState)
+{
+	InputRecorder::INPUT_EVENT event;
+	while (m_inputRecorder.ReadEvent(event))
+	{
+		if (event.type == InputRecorder::EVENT_CURSOR)
+		{
+			ApplyCursorPosition(event.x, event.y);
+		}
+		else if (event.type == InputRecorder::EVENT_SCROLL)
+		{
+			ApplyScroll(event.y);
+		}
+		else
+		{
+			gDeltaTime = (float)event.y;
+			keyState = event.keyState;
+			return(true);
+		}
+	}
 
-	// set the current positions into the last position variables
-	gLastX = xMousePos;
-	gLastY = yMousePos;
+	glfwSetWindowShouldClose(m_pWindow, true);
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	return(false);
 }
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
  *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  that may be waiting in the event queue.  Escape and F12
+ *  always apply; the camera keys are ignored while a camera
+ *  path drives the camera.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::ProcessKeyboardEvents(unsigned int keyState, bool bCameraKeys)
 {
 	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_ESCAPE))
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
-	// if the camera object is null, then exit this method
-	if (NULL == g_pCamera)
+	// held keys keep moving the camera, so the next frame has to
+	// be drawn as well
+	if (keyState != 0)
+	{
+		bViewDirty = true;
+	}
+
+	// write the trace recorded so far when F12 is pressed
+	bool bTraceKey = IsKeyDown(keyState, GLFW_KEY_F12);
+	if ((bTraceKey) && (!bTraceKeyDown) && (TraceRecorder::IsEnabled()))
+	{
+		TraceRecorder::WriteTrace();
+	}
+	bTraceKeyDown = bTraceKey;
+
+	// if the camera object is null or not driven by the keys,
+	// then exit this method
+	if ((NULL == g_pCamera) || (!bCameraKeys))
 	{
 		return;
 	}
 
 	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_W))
 	{
 		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_S))
 	{
 		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
 	}
 
 	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_A))
 	{
 		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_D))
 	{
 		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
 	}
 
 	// process camera panning up and down
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_Q))
 	{
 		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_E))
 	{
 		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
 	}
 
 	// toggle camera perspective 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_P))
 	{
 		bOrthographicProjection = false;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	if (IsKeyDown(keyState, GLFW_KEY_O))
 	{
 		bOrthographicProjection = true;
 	}
@@ -243,39 +617,144 @@ void ViewManager::PrepareSceneView()
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// the input of this frame is consumed below, anything that
+	// arrives afterwards marks the next one
+	bViewDirty = false;
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	bCameraPathPlaying = (NULL != m_pCameraPath);
+	bInputReplaying = m_inputRecorder.IsReplaying();
+	if (bCameraPathPlaying)
+	{
+		// the path is sampled at a fixed timestep, not the
+		// measured frame time
+		gDeltaTime = m_fixedTimestep;
+		CameraPath::KEYFRAME keyframe = m_pCameraPath->Evaluate(m_playbackFrame * m_fixedTimestep);
+		g_pCamera->Position = keyframe.position;
+		g_pCamera->Front = keyframe.front;
+		g_pCamera->Zoom = keyframe.zoom;
+		m_playbackFrame++;
+
+		// escape and F12 still work while the path plays
+		ProcessKeyboardEvents(SampleKeys(), false);
+	}
+	else if (bInputReplaying)
+	{
+		// the recorded frame time stands in for the clock
+		unsigned int keyState = 0;
+		if (ReadReplayedFrame(keyState))
+		{
+			// the live escape key still ends a windowed replay
+			if (IsKeyDown(SampleKeys(), GLFW_KEY_ESCAPE))
+			{
+				keyState |= (1u << ESCAPE_KEY_INDEX);
+			}
+			ProcessKeyboardEvents(keyState, true);
+		}
+	}
+	else
+	{
+		// per-frame timing
+		float currentFrame = glfwGetTime();
+		gDeltaTime = currentFrame - gLastFrame;
+		gLastFrame = currentFrame;
+
+		// process any keyboard events that may be waiting in the 
+		// event queue
+		unsigned int keyState = SampleKeys();
+		m_inputRecorder.RecordFrame(currentFrame - m_recordStart, gDeltaTime, keyState);
+		ProcessKeyboardEvents(keyState, true);
+	}
 
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix();
 
 	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)m_frameWidth / (GLfloat)m_frameHeight, 0.1f, 100.0f);
 
 	// toggling between orthographic and perspective
 	if (bOrthographicProjection)
 	{
-		float aspectRat = (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
+		float aspectRat = (GLfloat)m_frameWidth / (GLfloat)m_frameHeight;
 		projection = glm::ortho(-10.0f * aspectRat, 10.0f * aspectRat, -10.0f, 10.0f, 0.2f, 100.0f);
 	}
 	else
 	{
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)m_frameWidth / (GLfloat)m_frameHeight, 0.1f, 100.0f);
 	}
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+
+	// keep the matrices for the scene manager
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+
+	// if the uniform cache object is valid
+	if (NULL != m_pUniformCache)
 	{
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		m_pUniformCache->SetMat4Value(m_viewUniform, view);
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+		m_pUniformCache->SetMat4Value(m_projectionUniform, projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pUniformCache->SetVec3Value(m_viewPositionUniform, g_pCamera->Position);
 	}
+}
+
+/***********************************************************
+ *  IsViewDirty()
+ *
+ *  This method is used for checking whether the view has to
+ *  be drawn again.  A playing camera path or input log
+ *  changes the view every frame.
+ ***********************************************************/
+bool ViewManager::IsViewDirty() const
+{
+	return((bViewDirty) || (NULL != m_pCameraPath) || (m_inputRecorder.IsReplaying()));
+}
+
+/***********************************************************
+ *  WaitForEvents()
+ *
+ *  This method is used for sleeping until the next input or
+ *  window event, or until the passed in timeout.  The frame
+ *  clock is restarted afterwards, so the first frame after
+ *  an idle wait does not move the camera by the time spent
+ *  waiting.
+ ***********************************************************/
+void ViewManager::WaitForEvents(double timeoutSeconds)
+{
+	glfwWaitEventsTimeout(timeoutSeconds);
+	gLastFrame = glfwGetTime();
+}
+
+/***********************************************************
+ *  GetCameraPosition()
+ *
+ *  This method is used for getting the current position
+ *  of the camera in world space.
+ ***********************************************************/
+glm::vec3 ViewManager::GetCameraPosition() const
+{
+	if (NULL == g_pCamera)
+	{
+		return(glm::vec3(0.0f, 0.0f, 0.0f));
+	}
+
+	return(g_pCamera->Position);
+}
+
+/***********************************************************
+ *  GetCameraKeyframe()
+ *
+ *  This method is used for getting the current position,
+ *  view direction and zoom of the camera as a keyframe at
+ *  the passed in time.
+ ***********************************************************/
+CameraPath::KEYFRAME ViewManager::GetCameraKeyframe(float time) const
+{
+	CameraPath::KEYFRAME keyframe;
+	keyframe.time = time;
+	keyframe.position = GetCameraPosition();
+	keyframe.front = (NULL != g_pCamera) ? g_pCamera->Front : glm::vec3(0.0f, 0.0f, -1.0f);
+	keyframe.zoom = (NULL != g_pCamera) ? g_pCamera->Zoom : 45.0f;
+
+	return(keyframe);
 }
\ No newline at end of file
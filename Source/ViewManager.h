@@ -10,6 +10,9 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "UniformCache.h"
+#include "CameraPath.h"
+#include "InputRecorder.h"
 #include "camera.h"
 
 // GLFW library
@@ -30,20 +33,92 @@ public:
 	// mouse sensitivity callback for mouse scrollwheel 
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
 
+	// key, resize and expose callbacks that mark the view for
+	// redrawing when rendering on demand
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+	static void Window_Refresh_Callback(GLFWwindow* window);
+
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the uniform location cache of the shader program
+	UniformCache* m_pUniformCache;
+	// uniform handles resolved from the uniform cache
+	int m_viewUniform;
+	int m_projectionUniform;
+	int m_viewPositionUniform;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// size of the rendered frames
+	int m_frameWidth;
+	int m_frameHeight;
+	// true when the window is hidden and takes no input
+	bool m_bHeadless;
+	// camera track played back instead of the live input, and
+	// the fixed time between its frames
+	const CameraPath* m_pCameraPath;
+	float m_fixedTimestep;
+	int m_playbackFrame;
+	// input log being recorded or replayed, and the time the
+	// recording started
+	InputRecorder m_inputRecorder;
+	float m_recordStart;
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// get the state of the keys used by the scene, one bit each
+	unsigned int SampleKeys();
+	// apply the replayed input up to the next frame, false once
+	// the log is done
+	bool ReadReplayedFrame(unsigned int& keyState);
+	// process keyboard events for interaction with the 3D scene,
+	// the camera keys only when asked for
+	void ProcessKeyboardEvents(unsigned int keyState, bool bCameraKeys);
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create a hidden window that only provides the OpenGL
+	// context for offscreen rendering
+	GLFWwindow* CreateHeadlessWindow(const char* windowTitle, int frameWidth, int frameHeight);
+
+	// set the uniform cache once the shader program is loaded
+	void SetUniformCache(UniformCache* pUniformCache);
+	// drive the camera from the passed in path, advanced by the
+	// passed in seconds every frame, instead of from the input
+	void SetCameraPath(const CameraPath* pCameraPath, float timestep);
+	// record every input event to a binary log, or replay one
+	// instead of the live input
+	bool StartInputRecording(const char* filename);
+	bool StartInputReplay(const char* filename);
+	// close the input log being recorded or replayed
+	void StopInput();
+	// true once a replayed input log has no frames left, checked
+	// before starting a frame
+	bool IsInputReplayDone() const;
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// true when input, a resize or a playing camera track has
+	// changed the view since the last PrepareSceneView
+	bool IsViewDirty() const;
+	// sleep until an input or window event arrives or the passed
+	// in seconds pass, without counting the wait as frame time
+	void WaitForEvents(double timeoutSeconds);
+
+	// get the current position of the camera
+	glm::vec3 GetCameraPosition() const;
+	// get the current camera state as a keyframe at the passed
+	// in time, for recording camera paths
+	CameraPath::KEYFRAME GetCameraKeyframe(float time) const;
+	// get the matrices set by the last PrepareSceneView
+	const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+	const glm::mat4& GetProjectionMatrix() const { return m_projectionMatrix; }
+	// get the size of the rendered frames
+	int GetFrameWidth() const { return m_frameWidth; }
+	int GetFrameHeight() const { return m_frameHeight; }
 };
\ No newline at end of file
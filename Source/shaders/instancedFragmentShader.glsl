@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedFragmentShader.glsl
+// ============
+// fragment shader for drawing instances of the shared basic shape meshes
+//
+//  Uses the same light sources as the scene shader, with the material of
+//  each instance read from the material uniform buffer.
+///////////////////////////////////////////////////////////////////////////////
+#version 440 core
+
+// bindless handles are optional, the array textures are sampled when the
+// extension is missing or bUseBindlessTextures is false.  Handles differ
+// between the instances of a draw, which NV_gpu_shader5 allows.
+#extension GL_ARB_bindless_texture : enable
+#extension GL_NV_gpu_shader5 : enable
+
+#define TOTAL_LIGHTS 4
+#define MAX_MATERIALS 256
+#define MAX_TEXTURE_ARRAYS 8
+#define MAX_ARRAY_LAYERS 2048
+#define MAX_BLOCK_TEXTURES 256
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+// matches SceneManager::MATERIAL_BLOCK_ENTRY
+struct MaterialData
+{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+};
+
+layout (std140) uniform MaterialBlock
+{
+	MaterialData materials[MAX_MATERIALS];
+	// bindless handle of each texture slot in xy
+	uvec4 textureHandles[MAX_BLOCK_TEXTURES];
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+in vec4 fragmentColor;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureLayer;
+
+out vec4 outFragmentColor;
+
+uniform bool bUseLighting;
+uniform sampler2DArray textureArrays[MAX_TEXTURE_ARRAYS];
+uniform bool bUseBindlessTextures;
+uniform vec3 viewPosition;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+vec3 CalculateLight(LightSource light, MaterialData material, vec3 normal, vec3 viewDirection)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+
+	vec3 ambient = light.ambientColor * material.ambient.rgb * material.ambient.a;
+
+	float impact = max(dot(normal, lightDirection), 0.0);
+	vec3 diffuse = impact * light.diffuseColor * material.diffuse.rgb;
+
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float highlight = pow(max(dot(viewDirection, reflectDirection), 0.0), max(material.specular.a, 1.0));
+	vec3 specular = light.specularIntensity * highlight * light.specularColor * material.specular.rgb;
+
+	return ambient + diffuse + specular;
+}
+
+// sampler arrays may only be indexed with constants across a draw
+// that mixes textures, so the array selects a constant index and
+// the layer is read from the packed value.  In bindless mode the
+// value is the texture slot instead.
+vec4 SampleObjectTexture(int packedLayer, vec2 uv)
+{
+#ifdef GL_ARB_bindless_texture
+	if (bUseBindlessTextures)
+	{
+		return texture(sampler2D(textureHandles[packedLayer].xy), uv);
+	}
+#endif
+
+	vec3 coordinate = vec3(uv, float(packedLayer % MAX_ARRAY_LAYERS));
+	switch (packedLayer / MAX_ARRAY_LAYERS)
+	{
+	case 0: return texture(textureArrays[0], coordinate);
+	case 1: return texture(textureArrays[1], coordinate);
+	case 2: return texture(textureArrays[2], coordinate);
+	case 3: return texture(textureArrays[3], coordinate);
+	case 4: return texture(textureArrays[4], coordinate);
+	case 5: return texture(textureArrays[5], coordinate);
+	case 6: return texture(textureArrays[6], coordinate);
+	case 7: return texture(textureArrays[7], coordinate);
+	}
+	return fragmentColor;
+}
+
+void main()
+{
+	vec4 surfaceColor = fragmentColor;
+	if (fragmentTextureLayer >= 0)
+	{
+		surfaceColor = SampleObjectTexture(fragmentTextureLayer, fragmentTextureCoordinate);
+	}
+
+	if (!bUseLighting)
+	{
+		outFragmentColor = surfaceColor;
+		return;
+	}
+
+	MaterialData material = materials[fragmentMaterialIndex];
+	vec3 normal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+
+	vec3 phong = vec3(0.0);
+	for (int i = 0; i < TOTAL_LIGHTS; i++)
+	{
+		phong += CalculateLight(lightSources[i], material, normal, viewDirection);
+	}
+
+	outFragmentColor = vec4(phong * surfaceColor.rgb, surfaceColor.a);
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedVertexShader.glsl
+// ============
+// vertex shader for drawing instances of the shared basic shape meshes
+//
+//  The model matrix, color, UV scale and material index are per-instance
+//  attributes supplied by ShapeBuffer instead of uniforms.
+///////////////////////////////////////////////////////////////////////////////
+#version 440 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// per-instance attributes, the matrix uses locations 3 through 6
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in vec4 instanceColor;
+// xy UV scale, z material index, w packed array texture layer plus one,
+// or texture slot plus one in bindless mode, 0 when untextured
+layout (location = 8) in vec4 instanceParams;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+out vec4 fragmentColor;
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+	vec4 worldPosition = instanceModel * vec4(inVertexPosition, 1.0);
+	gl_Position = projection * view * worldPosition;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = mat3(transpose(inverse(instanceModel))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate * instanceParams.xy;
+	fragmentColor = instanceColor;
+	fragmentMaterialIndex = int(instanceParams.z);
+	fragmentTextureLayer = int(instanceParams.w) - 1;
+}